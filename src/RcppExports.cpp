@@ -11,6 +11,161 @@ Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
 Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
+// cpp_compact
+Rcpp::RawVector cpp_compact(Rcpp::NumericMatrix mat_, std::string precision);
+RcppExport SEXP _wordvector_cpp_compact(SEXP mat_SEXP, SEXP precisionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::NumericMatrix >::type mat_(mat_SEXP);
+    Rcpp::traits::input_parameter< std::string >::type precision(precisionSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_compact(mat_, precision));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_decompact
+Rcpp::NumericMatrix cpp_decompact(Rcpp::RawVector x_, int nrow, int ncol, std::string precision, Rcpp::IntegerVector rows_, bool normalize);
+RcppExport SEXP _wordvector_cpp_decompact(SEXP x_SEXP, SEXP nrowSEXP, SEXP ncolSEXP, SEXP precisionSEXP, SEXP rows_SEXP, SEXP normalizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RawVector >::type x_(x_SEXP);
+    Rcpp::traits::input_parameter< int >::type nrow(nrowSEXP);
+    Rcpp::traits::input_parameter< int >::type ncol(ncolSEXP);
+    Rcpp::traits::input_parameter< std::string >::type precision(precisionSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type rows_(rows_SEXP);
+    Rcpp::traits::input_parameter< bool >::type normalize(normalizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_decompact(x_, nrow, ncol, precision, rows_, normalize));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_compact_prod
+Rcpp::NumericMatrix cpp_compact_prod(Rcpp::RawVector x_, int nrow, int ncol, std::string precision, Rcpp::NumericMatrix y_, bool cosine, int threads);
+RcppExport SEXP _wordvector_cpp_compact_prod(SEXP x_SEXP, SEXP nrowSEXP, SEXP ncolSEXP, SEXP precisionSEXP, SEXP y_SEXP, SEXP cosineSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RawVector >::type x_(x_SEXP);
+    Rcpp::traits::input_parameter< int >::type nrow(nrowSEXP);
+    Rcpp::traits::input_parameter< int >::type ncol(ncolSEXP);
+    Rcpp::traits::input_parameter< std::string >::type precision(precisionSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericMatrix >::type y_(y_SEXP);
+    Rcpp::traits::input_parameter< bool >::type cosine(cosineSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_compact_prod(x_, nrow, ncol, precision, y_, cosine, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_index_build
+SEXP cpp_index_build(SEXP x_, int M, int ef_construction, int threads);
+RcppExport SEXP _wordvector_cpp_index_build(SEXP x_SEXP, SEXP MSEXP, SEXP ef_constructionSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x_(x_SEXP);
+    Rcpp::traits::input_parameter< int >::type M(MSEXP);
+    Rcpp::traits::input_parameter< int >::type ef_construction(ef_constructionSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_index_build(x_, M, ef_construction, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_index_search
+Rcpp::List cpp_index_search(SEXP index_, Rcpp::NumericMatrix y_, int n, int ef, int threads);
+RcppExport SEXP _wordvector_cpp_index_search(SEXP index_SEXP, SEXP y_SEXP, SEXP nSEXP, SEXP efSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type index_(index_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericMatrix >::type y_(y_SEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< int >::type ef(efSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_index_search(index_, y_, n, ef, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_index_vectors
+Rcpp::NumericMatrix cpp_index_vectors(SEXP index_, Rcpp::IntegerVector rows_);
+RcppExport SEXP _wordvector_cpp_index_vectors(SEXP index_SEXP, SEXP rows_SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type index_(index_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type rows_(rows_SEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_index_vectors(index_, rows_));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_index_save
+void cpp_index_save(SEXP index_, Rcpp::CharacterVector labels_, std::string file);
+RcppExport SEXP _wordvector_cpp_index_save(SEXP index_SEXP, SEXP labels_SEXP, SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type index_(index_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::CharacterVector >::type labels_(labels_SEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    cpp_index_save(index_, labels_, file);
+    return R_NilValue;
+END_RCPP
+}
+// cpp_index_load
+Rcpp::List cpp_index_load(std::string file);
+RcppExport SEXP _wordvector_cpp_index_load(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_index_load(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_probability
+Rcpp::NumericMatrix cpp_probability(SEXP x_, Rcpp::NumericMatrix y_, Rcpp::NumericVector weight_, int threads);
+RcppExport SEXP _wordvector_cpp_probability(SEXP x_SEXP, SEXP y_SEXP, SEXP weight_SEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x_(x_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericMatrix >::type y_(y_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type weight_(weight_SEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_probability(x_, y_, weight_, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_perplexity
+double cpp_perplexity(SEXP x_, Rcpp::NumericMatrix y_, Rcpp::IntegerVector target_, Rcpp::IntegerVector rows_, Rcpp::IntegerVector p_, Rcpp::IntegerVector i_, Rcpp::NumericVector count_, int threads);
+RcppExport SEXP _wordvector_cpp_perplexity(SEXP x_SEXP, SEXP y_SEXP, SEXP target_SEXP, SEXP rows_SEXP, SEXP p_SEXP, SEXP i_SEXP, SEXP count_SEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x_(x_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericMatrix >::type y_(y_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type target_(target_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type rows_(rows_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type p_(p_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type i_(i_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type count_(count_SEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_perplexity(x_, y_, target_, rows_, p_, i_, count_, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_similarity
+Rcpp::List cpp_similarity(SEXP x_, Rcpp::NumericMatrix y_, int n, int threads);
+RcppExport SEXP _wordvector_cpp_similarity(SEXP x_SEXP, SEXP y_SEXP, SEXP nSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x_(x_SEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericMatrix >::type y_(y_SEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_similarity(x_, y_, n, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_get_max_thread
 int cpp_get_max_thread();
 RcppExport SEXP _wordvector_cpp_get_max_thread() {
@@ -22,18 +177,20 @@ BEGIN_RCPP
 END_RCPP
 }
 // cpp_word2vec
-Rcpp::List cpp_word2vec(TokensPtr xptr, List model, uint16_t size, uint16_t window, float sample, bool withHS, uint16_t negative, uint16_t threads, uint16_t iterations, float alpha, int type, bool doc2vec, bool verbose, bool normalize);
-RcppExport SEXP _wordvector_cpp_word2vec(SEXP xptrSEXP, SEXP modelSEXP, SEXP sizeSEXP, SEXP windowSEXP, SEXP sampleSEXP, SEXP withHSSEXP, SEXP negativeSEXP, SEXP threadsSEXP, SEXP iterationsSEXP, SEXP alphaSEXP, SEXP typeSEXP, SEXP doc2vecSEXP, SEXP verboseSEXP, SEXP normalizeSEXP) {
+Rcpp::List cpp_word2vec(SEXP x_, List model, uint16_t size, uint16_t window, float sample, bool withHS, uint16_t negative, float nsPower, bool batch, uint16_t threads, uint16_t iterations, float alpha, int type, bool doc2vec, bool verbose, bool normalize, bool hugePages, bool deterministic, float interval, int minCount);
+RcppExport SEXP _wordvector_cpp_word2vec(SEXP x_SEXP, SEXP modelSEXP, SEXP sizeSEXP, SEXP windowSEXP, SEXP sampleSEXP, SEXP withHSSEXP, SEXP negativeSEXP, SEXP nsPowerSEXP, SEXP batchSEXP, SEXP threadsSEXP, SEXP iterationsSEXP, SEXP alphaSEXP, SEXP typeSEXP, SEXP doc2vecSEXP, SEXP verboseSEXP, SEXP normalizeSEXP, SEXP hugePagesSEXP, SEXP deterministicSEXP, SEXP intervalSEXP, SEXP minCountSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< TokensPtr >::type xptr(xptrSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type x_(x_SEXP);
     Rcpp::traits::input_parameter< List >::type model(modelSEXP);
     Rcpp::traits::input_parameter< uint16_t >::type size(sizeSEXP);
     Rcpp::traits::input_parameter< uint16_t >::type window(windowSEXP);
     Rcpp::traits::input_parameter< float >::type sample(sampleSEXP);
     Rcpp::traits::input_parameter< bool >::type withHS(withHSSEXP);
     Rcpp::traits::input_parameter< uint16_t >::type negative(negativeSEXP);
+    Rcpp::traits::input_parameter< float >::type nsPower(nsPowerSEXP);
+    Rcpp::traits::input_parameter< bool >::type batch(batchSEXP);
     Rcpp::traits::input_parameter< uint16_t >::type threads(threadsSEXP);
     Rcpp::traits::input_parameter< uint16_t >::type iterations(iterationsSEXP);
     Rcpp::traits::input_parameter< float >::type alpha(alphaSEXP);
@@ -41,14 +198,41 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type doc2vec(doc2vecSEXP);
     Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
     Rcpp::traits::input_parameter< bool >::type normalize(normalizeSEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_word2vec(xptr, model, size, window, sample, withHS, negative, threads, iterations, alpha, type, doc2vec, verbose, normalize));
+    Rcpp::traits::input_parameter< bool >::type hugePages(hugePagesSEXP);
+    Rcpp::traits::input_parameter< bool >::type deterministic(deterministicSEXP);
+    Rcpp::traits::input_parameter< float >::type interval(intervalSEXP);
+    Rcpp::traits::input_parameter< int >::type minCount(minCountSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_word2vec(x_, model, size, window, sample, withHS, negative, nsPower, batch, threads, iterations, alpha, type, doc2vec, verbose, normalize, hugePages, deterministic, interval, minCount));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_write_tokens
+void cpp_write_tokens(TokensPtr xptr, std::string file);
+RcppExport SEXP _wordvector_cpp_write_tokens(SEXP xptrSEXP, SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< TokensPtr >::type xptr(xptrSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    cpp_write_tokens(xptr, file);
+    return R_NilValue;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_wordvector_cpp_compact", (DL_FUNC) &_wordvector_cpp_compact, 2},
+    {"_wordvector_cpp_decompact", (DL_FUNC) &_wordvector_cpp_decompact, 6},
+    {"_wordvector_cpp_compact_prod", (DL_FUNC) &_wordvector_cpp_compact_prod, 7},
+    {"_wordvector_cpp_index_build", (DL_FUNC) &_wordvector_cpp_index_build, 4},
+    {"_wordvector_cpp_index_search", (DL_FUNC) &_wordvector_cpp_index_search, 5},
+    {"_wordvector_cpp_index_vectors", (DL_FUNC) &_wordvector_cpp_index_vectors, 2},
+    {"_wordvector_cpp_index_save", (DL_FUNC) &_wordvector_cpp_index_save, 3},
+    {"_wordvector_cpp_index_load", (DL_FUNC) &_wordvector_cpp_index_load, 1},
+    {"_wordvector_cpp_probability", (DL_FUNC) &_wordvector_cpp_probability, 4},
+    {"_wordvector_cpp_perplexity", (DL_FUNC) &_wordvector_cpp_perplexity, 8},
+    {"_wordvector_cpp_similarity", (DL_FUNC) &_wordvector_cpp_similarity, 4},
     {"_wordvector_cpp_get_max_thread", (DL_FUNC) &_wordvector_cpp_get_max_thread, 0},
-    {"_wordvector_cpp_word2vec", (DL_FUNC) &_wordvector_cpp_word2vec, 14},
+    {"_wordvector_cpp_word2vec", (DL_FUNC) &_wordvector_cpp_word2vec, 20},
+    {"_wordvector_cpp_write_tokens", (DL_FUNC) &_wordvector_cpp_write_tokens, 2},
     {NULL, NULL, 0}
 };
 
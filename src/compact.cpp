@@ -0,0 +1,108 @@
+#include <Rcpp.h>
+#include "compact.h"
+#include "utility.h"
+#include "word2vec/kernels.hpp"
+
+// [[Rcpp::export]]
+Rcpp::RawVector cpp_compact(Rcpp::NumericMatrix mat_, std::string precision) {
+
+    precision_t prec = get_precision(precision);
+    std::size_t bytes = get_bytes(prec);
+    std::size_t nrow = mat_.nrow();
+    std::size_t ncol = mat_.ncol();
+    Rcpp::RawVector x_(nrow * ncol * bytes);
+    uint8_t *x = RAW(x_);
+    const double *mat = mat_.begin();
+    // rows in a block stay in the cache while the columns are read contiguously
+    const std::size_t block = 64;
+    for (std::size_t i0 = 0; i0 < nrow; i0 += block) {
+        std::size_t i1 = std::min(i0 + block, nrow);
+        for (std::size_t k = 0; k < ncol; ++k) {
+            const double *col = mat + k * nrow;
+            for (std::size_t i = i0; i < i1; ++i) {
+                uint8_t *p = x + (i * ncol + k) * bytes;
+                float f = static_cast<float>(col[i]);
+                if (prec == FLOAT) {
+                    std::memcpy(p, &f, 4);
+                } else {
+                    uint16_t h = prec == BFLOAT16 ? to_bfloat16(f) : to_float16(f);
+                    std::memcpy(p, &h, 2);
+                }
+            }
+        }
+    }
+    return x_;
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericMatrix cpp_decompact(Rcpp::RawVector x_, int nrow, int ncol, std::string precision,
+                                  Rcpp::IntegerVector rows_, bool normalize) {
+
+    precision_t prec = get_precision(precision);
+    if ((std::size_t)x_.size() != (std::size_t)nrow * ncol * get_bytes(prec))
+        throw std::range_error("Invalid compact matrix");
+    std::size_t n = rows_.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (rows_[i] == NA_INTEGER || rows_[i] < 1 || rows_[i] > nrow)
+            throw std::range_error("Invalid row index");
+    }
+    Rcpp::NumericMatrix mat_(n, ncol);
+    double *mat = mat_.begin();
+    const uint8_t *x = RAW(x_);
+    std::vector<float> row(ncol);
+    for (std::size_t i = 0; i < n; ++i) {
+        decode_row(x, rows_[i] - 1, ncol, prec, row.data());
+        double scale = 1.0;
+        if (normalize) {
+            double ss = 0.0;
+            for (int k = 0; k < ncol; ++k)
+                ss += (double)row[k] * row[k];
+            scale = 1.0 / std::sqrt(ss / ncol);
+        }
+        for (int k = 0; k < ncol; ++k)
+            mat[k * n + i] = row[k] * scale;
+    }
+    return mat_;
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericMatrix cpp_compact_prod(Rcpp::RawVector x_, int nrow, int ncol, std::string precision,
+                                     Rcpp::NumericMatrix y_, bool cosine, int threads) {
+
+    precision_t prec = get_precision(precision);
+    if ((std::size_t)x_.size() != (std::size_t)nrow * ncol * get_bytes(prec))
+        throw std::range_error("Invalid compact matrix");
+    if (y_.ncol() != ncol)
+        throw std::range_error("Invalid matrix size");
+
+    // targets in row-major floats, normalized to the unit length for cosine similarity
+    std::size_t m = y_.nrow();
+    std::size_t K = ncol;
+    std::vector<float> y(m * K);
+    for (std::size_t j = 0; j < m; ++j) {
+        double ss = 0.0;
+        for (std::size_t k = 0; k < K; ++k)
+            ss += y_(j, k) * y_(j, k);
+        double scale = cosine ? 1.0 / std::sqrt(ss) : 1.0;
+        for (std::size_t k = 0; k < K; ++k)
+            y[j * K + k] = y_(j, k) * scale;
+    }
+
+    Rcpp::NumericMatrix res_(nrow, m);
+    double *res = res_.begin();
+    const uint8_t *x = RAW(x_);
+    const w2v::kernels_t &kernels = w2v::kernels();
+    parallel_for(nrow, threads, [&](std::size_t from, std::size_t to) {
+        std::vector<float> row(K);
+        for (std::size_t i = from; i < to; ++i) {
+            decode_row(x, i, K, prec, row.data());
+            float scale = 1.0f;
+            if (cosine)
+                scale = 1.0f / std::sqrt(kernels.dot(row.data(), row.data(), K)); // NaN for zero vectors
+            for (std::size_t j = 0; j < m; ++j) {
+                res[j * nrow + i] = kernels.dot(row.data(), y.data() + j * K, K) * scale;
+            }
+        }
+    });
+    return res_;
+}
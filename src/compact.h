@@ -0,0 +1,144 @@
+#ifndef WORDVECTOR_COMPACT_H
+#define WORDVECTOR_COMPACT_H
+
+#include <Rcpp.h>
+#include <cstdint>
+#include <cstring>
+
+// Matrices in compact storage are raw vectors of row-major single (float),
+// brain floating point (bfloat16) or half-precision (float16) values
+
+enum precision_t {FLOAT, BFLOAT16, FLOAT16};
+
+inline precision_t get_precision(const std::string &precision) {
+    if (precision == "float") {
+        return FLOAT;
+    } else if (precision == "bfloat16") {
+        return BFLOAT16;
+    } else if (precision == "float16") {
+        return FLOAT16;
+    }
+    throw std::range_error("Invalid precision");
+}
+
+inline std::size_t get_bytes(precision_t precision) {
+    return precision == FLOAT ? 4 : 2;
+}
+
+inline uint32_t float_bits(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+inline float bits_float(uint32_t u) {
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+inline uint16_t to_bfloat16(float f) {
+    uint32_t u = float_bits(f);
+    if ((u & 0x7fffffff) > 0x7f800000) // NaN
+        return (u >> 16) | 0x0040;
+    u += 0x7fff + ((u >> 16) & 1); // round to nearest even
+    return u >> 16;
+}
+
+inline float from_bfloat16(uint16_t h) {
+    return bits_float(static_cast<uint32_t>(h) << 16);
+}
+
+inline uint16_t to_float16(float f) {
+    uint32_t u = float_bits(f);
+    uint16_t sign = (u >> 16) & 0x8000;
+    uint32_t abs = u & 0x7fffffff;
+    if (abs > 0x7f800000) // NaN
+        return sign | 0x7e00;
+    if (abs >= 0x477ff000) // overflow after rounding
+        return sign | 0x7c00;
+    if (abs < 0x38800000) { // subnormal or zero
+        if (abs < 0x33000000)
+            return sign;
+        uint32_t mant = (abs & 0x007fffff) | 0x00800000;
+        int shift = 126 - (abs >> 23); // between 14 and 24
+        uint32_t half = mant >> shift;
+        uint32_t rest = mant & ((1u << shift) - 1);
+        uint32_t mid = 1u << (shift - 1);
+        if (rest > mid || (rest == mid && (half & 1)))
+            half++;
+        return sign | half;
+    }
+    abs += 0xc8000fff + ((abs >> 13) & 1); // rebias exponent and round to nearest even
+    return sign | (abs >> 13);
+}
+
+inline float from_float16(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x03ff;
+    if (exp == 0x1f) // infinity or NaN
+        return bits_float(sign | 0x7f800000 | (mant << 13));
+    if (exp == 0) // subnormal or zero
+        return bits_float(sign | float_bits(mant * 5.9604644775390625e-8f)); // 2^-24
+    return bits_float(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+// decode the i-th row into a float buffer
+inline void decode_row(const uint8_t *x, std::size_t i, std::size_t ncol, precision_t precision,
+                float *row) {
+    if (precision == FLOAT) {
+        std::memcpy(row, x + i * ncol * 4, ncol * 4);
+    } else {
+        const uint8_t *p = x + i * ncol * 2;
+        for (std::size_t k = 0; k < ncol; ++k) {
+            uint16_t h;
+            std::memcpy(&h, p + k * 2, 2);
+            row[k] = precision == BFLOAT16 ? from_bfloat16(h) : from_float16(h);
+        }
+    }
+}
+
+// rows of a column-major double matrix or a matrix in compact storage
+struct rows_t {
+    std::size_t nrow = 0;
+    std::size_t ncol = 0;
+    precision_t precision = FLOAT;
+    bool compact = false;
+    const uint8_t *raw = nullptr;
+    const double *mat = nullptr;
+
+    // copy a row to floats
+    void get(std::size_t i, float *row) const {
+        if (compact) {
+            decode_row(raw, i, ncol, precision, row);
+        } else {
+            for (std::size_t k = 0; k < ncol; ++k)
+                row[k] = static_cast<float>(mat[k * nrow + i]);
+        }
+    }
+};
+
+inline rows_t get_rows(SEXP x_) {
+    rows_t rows;
+    rows.compact = TYPEOF(x_) == RAWSXP;
+    if (rows.compact) {
+        Rcpp::IntegerVector size_ = Rf_getAttrib(x_, Rf_install("size"));
+        Rcpp::CharacterVector precision_ = Rf_getAttrib(x_, Rf_install("precision"));
+        rows.nrow = size_[0];
+        rows.ncol = size_[1];
+        rows.precision = get_precision(Rcpp::as<std::string>(precision_[0]));
+        if ((std::size_t)Rf_xlength(x_) != rows.nrow * rows.ncol * get_bytes(rows.precision))
+            throw std::range_error("Invalid compact matrix");
+        rows.raw = RAW(x_);
+    } else if (Rf_isReal(x_) && Rf_isMatrix(x_)) {
+        rows.nrow = Rf_nrows(x_);
+        rows.ncol = Rf_ncols(x_);
+        rows.mat = REAL(x_);
+    } else {
+        throw std::range_error("Invalid matrix");
+    }
+    return rows;
+}
+
+#endif
@@ -0,0 +1,156 @@
+#include <Rcpp.h>
+#include <fstream>
+#include "compact.h"
+#include "utility.h"
+#include "word2vec/hnsw.hpp"
+
+typedef Rcpp::XPtr<w2v::hnsw_t> index_ptr;
+
+w2v::hnsw_t &get_index(SEXP index_) {
+    if (TYPEOF(index_) != EXTPTRSXP || R_ExternalPtrAddr(index_) == nullptr)
+        throw std::range_error("Invalid index; saved indices must be loaded by load_index()");
+    return *static_cast<w2v::hnsw_t*>(R_ExternalPtrAddr(index_));
+}
+
+// [[Rcpp::export]]
+SEXP cpp_index_build(SEXP x_, int M, int ef_construction, int threads) {
+
+    // rows of x in a double matrix or compact storage
+    rows_t x = get_rows(x_);
+    std::size_t nrow = x.nrow;
+    std::size_t ncol = x.ncol;
+
+    w2v::matrix_t mat(nrow, ncol);
+    parallel_for(nrow, threads, [&](std::size_t from, std::size_t to) {
+        const std::size_t block = 64;
+        for (std::size_t i0 = from; i0 < to; i0 += block) {
+            std::size_t i1 = std::min(i0 + block, to);
+            if (x.compact) {
+                for (std::size_t i = i0; i < i1; ++i)
+                    x.get(i, mat.row(i));
+            } else {
+                for (std::size_t k = 0; k < ncol; ++k) {
+                    const double *col = x.mat + k * nrow;
+                    for (std::size_t i = i0; i < i1; ++i)
+                        mat.row(i)[k] = static_cast<float>(col[i]);
+                }
+            }
+        }
+    });
+
+    w2v::hnsw_t::params_t params;
+    params.M = M;
+    params.efConstruction = ef_construction;
+    return index_ptr(new w2v::hnsw_t(std::move(mat), params, threads), true);
+}
+
+// [[Rcpp::export]]
+Rcpp::List cpp_index_search(SEXP index_, Rcpp::NumericMatrix y_, int n, int ef, int threads) {
+
+    const w2v::hnsw_t &index = get_index(index_);
+    std::size_t K = index.ncol();
+    if ((std::size_t)y_.ncol() != K)
+        throw std::range_error("Invalid matrix size");
+    std::size_t m = y_.nrow();
+    std::size_t k = std::min<std::size_t>(std::max(n, 0), index.size());
+
+    // queries in row-major floats
+    std::vector<float> y(m * K);
+    for (std::size_t j = 0; j < m; ++j) {
+        for (std::size_t l = 0; l < K; ++l)
+            y[j * K + l] = y_(j, l);
+    }
+
+    Rcpp::IntegerMatrix index2_(k, m);
+    Rcpp::NumericMatrix score_(k, m);
+    std::fill(index2_.begin(), index2_.end(), NA_INTEGER);
+    std::fill(score_.begin(), score_.end(), NA_REAL);
+    int *idx = index2_.begin();
+    double *score = score_.begin();
+    parallel_for(m, threads, [&](std::size_t from, std::size_t to) {
+        w2v::hnsw_t::visited_t visited(index.size());
+        for (std::size_t j = from; j < to; ++j) {
+            auto res = index.search(y.data() + j * K, k, ef, visited);
+            for (std::size_t i = 0; i < res.size(); ++i) {
+                idx[j * k + i] = res[i].second + 1;
+                score[j * k + i] = res[i].first;
+            }
+        }
+    });
+    return Rcpp::List::create(
+        Rcpp::Named("index") = index2_,
+        Rcpp::Named("score") = score_
+    );
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericMatrix cpp_index_vectors(SEXP index_, Rcpp::IntegerVector rows_) {
+
+    const w2v::hnsw_t &index = get_index(index_);
+    std::size_t n = rows_.size();
+    std::size_t K = index.ncol();
+    Rcpp::NumericMatrix mat_(n, K);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (rows_[i] == NA_INTEGER || rows_[i] < 1 || (std::size_t)rows_[i] > index.size())
+            throw std::range_error("Invalid row index");
+        const float *row = index.vector(rows_[i] - 1);
+        for (std::size_t k = 0; k < K; ++k)
+            mat_(i, k) = row[k];
+    }
+    return mat_;
+}
+
+// [[Rcpp::export]]
+void cpp_index_save(SEXP index_, Rcpp::CharacterVector labels_, std::string file) {
+
+    const w2v::hnsw_t &index = get_index(index_);
+    if ((std::size_t)labels_.size() != index.size())
+        throw std::range_error("Invalid labels");
+    std::ofstream out(file, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("Failed to open " + file);
+    index.save(out);
+    // labels follow the graph with their lengths
+    for (R_xlen_t i = 0; i < labels_.size(); ++i) {
+        std::string label = Rcpp::as<std::string>(labels_[i]);
+        uint32_t len = label.size();
+        out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+        out.write(label.data(), len);
+    }
+    if (!out)
+        throw std::runtime_error("Failed to write " + file);
+}
+
+// [[Rcpp::export]]
+Rcpp::List cpp_index_load(std::string file) {
+
+    std::ifstream in(file, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Failed to open " + file);
+    std::unique_ptr<w2v::hnsw_t> index = w2v::hnsw_t::load(in);
+    // labels cannot be longer than the rest of the file
+    std::streampos pos = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streamoff rest = in.tellg() - pos;
+    in.seekg(pos);
+    Rcpp::CharacterVector labels_(index->size());
+    std::string label;
+    for (R_xlen_t i = 0; i < labels_.size(); ++i) {
+        uint32_t len = 0;
+        in.read(reinterpret_cast<char*>(&len), sizeof(len));
+        if (!in || len > rest)
+            throw std::runtime_error("Invalid index file");
+        label.resize(len);
+        in.read(&label[0], len);
+        if (!in)
+            throw std::runtime_error("Invalid index file");
+        labels_[i] = Rcpp::String(label, CE_UTF8);
+    }
+    return Rcpp::List::create(
+        Rcpp::Named("dim") = (int)index->ncol(),
+        Rcpp::Named("M") = (int)index->M(),
+        Rcpp::Named("ef_construction") = (int)index->efConstruction(),
+        Rcpp::Named("index") = index_ptr(index.release(), true),
+        Rcpp::Named("labels") = labels_
+    );
+}
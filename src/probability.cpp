@@ -0,0 +1,202 @@
+#include <Rcpp.h>
+#include "compact.h"
+#include "utility.h"
+#include "word2vec/kernels.hpp"
+
+inline double sigmoid(double v) {
+    return 1.0 / (1.0 + std::exp(-v));
+}
+
+// scores of features for targets computed at a time in perplexity (64MB)
+const std::size_t blockSize = 1 << 24;
+
+// targets in row-major floats
+std::vector<float> get_targets(Rcpp::NumericMatrix y_) {
+    std::size_t m = y_.nrow();
+    std::size_t K = y_.ncol();
+    std::vector<float> y(m * K);
+    for (std::size_t j = 0; j < m; ++j) {
+        for (std::size_t k = 0; k < K; ++k)
+            y[j * K + k] = y_(j, k);
+    }
+    return y;
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericMatrix cpp_probability(SEXP x_, Rcpp::NumericMatrix y_, Rcpp::NumericVector weight_,
+                                    int threads) {
+
+    rows_t x = get_rows(x_);
+    if ((std::size_t)y_.ncol() != x.ncol)
+        throw std::range_error("Invalid matrix size");
+    std::size_t m = y_.nrow();
+    std::size_t K = x.ncol;
+    bool weighted = weight_.size() > 0;
+    if (weighted && (std::size_t)weight_.size() != m)
+        throw std::range_error("Invalid weights");
+    std::vector<float> y = get_targets(y_);
+    std::vector<double> weight(weight_.begin(), weight_.end());
+
+    // weighted sums of probabilities do not need a column for each target
+    Rcpp::NumericMatrix res_(x.nrow, weighted ? 1 : m);
+    double *res = res_.begin();
+    const w2v::kernels_t &kernels = w2v::kernels();
+    parallel_for(x.nrow, threads, [&](std::size_t from, std::size_t to) {
+        std::vector<float> row(K);
+        for (std::size_t i = from; i < to; ++i) {
+            x.get(i, row.data());
+            double sum = 0.0;
+            for (std::size_t j = 0; j < m; ++j) {
+                double p = sigmoid(kernels.dot(row.data(), y.data() + j * K, K));
+                if (weighted) {
+                    sum += p * weight[j];
+                } else {
+                    res[j * x.nrow + i] = p;
+                }
+            }
+            if (weighted)
+                res[i] = sum;
+        }
+    });
+    return res_;
+}
+
+// [[Rcpp::export]]
+double cpp_perplexity(SEXP x_, Rcpp::NumericMatrix y_, Rcpp::IntegerVector target_,
+                      Rcpp::IntegerVector rows_, Rcpp::IntegerVector p_, Rcpp::IntegerVector i_,
+                      Rcpp::NumericVector count_, int threads) {
+
+    // documents are columns of a sparse feature-by-document matrix; the probabilities of target
+    // words are the sums of the word vectors' (or the document vector's) sigmoid scores
+    rows_t x = get_rows(x_);
+    if ((std::size_t)y_.ncol() != x.ncol)
+        throw std::range_error("Invalid matrix size");
+    std::size_t m = y_.nrow();
+    std::size_t K = x.ncol;
+    if (p_.size() == 0)
+        throw std::range_error("Invalid sparse matrix");
+    std::size_t ndoc = p_.size() - 1;
+    bool words = rows_.size() == 0;
+    if (!words && (std::size_t)rows_.size() != ndoc)
+        throw std::range_error("Invalid document rows");
+    for (R_xlen_t h = 0; h < i_.size(); ++h) {
+        if (i_[h] < 0 || i_[h] >= target_.size() || (words && (std::size_t)i_[h] >= x.nrow))
+            throw std::range_error("Invalid feature index");
+    }
+    for (R_xlen_t j = 0; j < target_.size(); ++j) {
+        if (target_[j] != NA_INTEGER && (target_[j] < 1 || (std::size_t)target_[j] > m))
+            throw std::range_error("Invalid target index");
+    }
+    for (R_xlen_t d = 0; d < rows_.size(); ++d) {
+        if (rows_[d] == NA_INTEGER || rows_[d] < 1 || (std::size_t)rows_[d] > x.nrow)
+            throw std::range_error("Invalid row index");
+    }
+
+    std::vector<float> y = get_targets(y_);
+    const int *p = p_.begin();
+    const int *index = i_.begin();
+    const int *target = target_.begin();
+    const int *rows = rows_.begin();
+    const double *count = count_.begin();
+
+    // documents with target words to predict
+    std::vector<char> found(ndoc, 0);
+    for (std::size_t d = 0; d < ndoc; ++d) {
+        for (int h = p[d]; h < p[d + 1] && !found[d]; ++h)
+            found[d] = target[index[h]] != NA_INTEGER;
+    }
+
+    // log-likelihood and counts of target words in each document, summed in a fixed order
+    std::vector<double> loglik(ndoc, 0.0), total(ndoc, 0.0);
+    const w2v::kernels_t &kernels = w2v::kernels();
+    if (words) {
+        // scores of the features for all the targets are computed once in blocks of features and
+        // added to the scores of the target words in the documents (sum[h] for each non-zero h)
+        std::vector<char> used(x.nrow, 0);
+        for (std::size_t d = 0; d < ndoc; ++d) {
+            for (int h = p[d]; h < p[d + 1] && found[d]; ++h)
+                used[index[h]] = 1;
+        }
+        std::vector<double> rowSum(x.nrow, 0.0); // scores of the features summed for the targets
+        std::vector<double> score(i_.size(), 0.0); // scores of the target words
+        std::size_t block = std::max<std::size_t>(blockSize / std::max<std::size_t>(m, 1), 1);
+        std::vector<float> table;
+        for (std::size_t first = 0; first < x.nrow; first += block) {
+            std::size_t last = std::min(first + block, x.nrow);
+            table.resize((last - first) * m);
+            parallel_for(last - first, threads, [&](std::size_t from, std::size_t to) {
+                std::vector<float> row(K);
+                for (std::size_t f = from; f < to; ++f) {
+                    if (!used[first + f])
+                        continue;
+                    x.get(first + f, row.data());
+                    float *s = table.data() + f * m;
+                    double sum = 0.0;
+                    for (std::size_t j = 0; j < m; ++j) {
+                        s[j] = sigmoid(kernels.dot(row.data(), y.data() + j * K, K));
+                        sum += s[j];
+                    }
+                    rowSum[first + f] = sum;
+                }
+            });
+            parallel_for(ndoc, threads, [&](std::size_t from, std::size_t to) {
+                for (std::size_t d = from; d < to; ++d) {
+                    if (!found[d])
+                        continue;
+                    for (int g = p[d]; g < p[d + 1]; ++g) {
+                        std::size_t f = index[g];
+                        if (f < first || f >= last)
+                            continue;
+                        const float *s = table.data() + (f - first) * m;
+                        for (int h = p[d]; h < p[d + 1]; ++h) {
+                            int t = target[index[h]];
+                            if (t != NA_INTEGER)
+                                score[h] += count[g] * s[t - 1];
+                        }
+                    }
+                }
+            });
+        }
+        for (std::size_t d = 0; d < ndoc; ++d) {
+            if (!found[d])
+                continue;
+            double sum = 0.0;
+            for (int h = p[d]; h < p[d + 1]; ++h)
+                sum += count[h] * rowSum[index[h]];
+            for (int h = p[d]; h < p[d + 1]; ++h) {
+                if (target[index[h]] == NA_INTEGER)
+                    continue;
+                loglik[d] += count[h] * std::log(score[h] / sum);
+                total[d] += count[h];
+            }
+        }
+    } else {
+        parallel_for(ndoc, threads, [&](std::size_t from, std::size_t to) {
+            std::vector<float> row(K);
+            std::vector<double> score(m);
+            for (std::size_t d = from; d < to; ++d) {
+                if (!found[d])
+                    continue; // no target words to predict
+                x.get(rows[d] - 1, row.data());
+                double sum = 0.0;
+                for (std::size_t j = 0; j < m; ++j) {
+                    score[j] = sigmoid(kernels.dot(row.data(), y.data() + j * K, K));
+                    sum += score[j];
+                }
+                for (int h = p[d]; h < p[d + 1]; ++h) {
+                    if (target[index[h]] == NA_INTEGER)
+                        continue;
+                    loglik[d] += count[h] * std::log(score[target[index[h]] - 1] / sum);
+                    total[d] += count[h];
+                }
+            }
+        });
+    }
+
+    double ll = 0.0, n = 0.0;
+    for (std::size_t d = 0; d < ndoc; ++d) {
+        ll += loglik[d];
+        n += total[d];
+    }
+    return std::exp(-ll / n);
+}
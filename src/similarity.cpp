@@ -0,0 +1,113 @@
+#include <Rcpp.h>
+#include <limits>
+#include <mutex>
+#include "compact.h"
+#include "utility.h"
+#include "word2vec/kernels.hpp"
+
+typedef std::pair<float, int> score_t; // score and row index
+
+// higher score first; lower index first for ties
+inline bool better(const score_t &a, const score_t &b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+// [[Rcpp::export]]
+Rcpp::List cpp_similarity(SEXP x_, Rcpp::NumericMatrix y_, int n, int threads) {
+    
+    // rows of x in a double matrix or compact storage
+    rows_t x = get_rows(x_);
+    std::size_t nrow = x.nrow;
+    std::size_t ncol = x.ncol;
+    if ((std::size_t)y_.ncol() != ncol)
+        throw std::range_error("Invalid matrix size");
+    std::size_t m = y_.nrow();
+    std::size_t k = std::min<std::size_t>(std::max(n, 0), nrow);
+    std::size_t K = ncol;
+    
+    // queries in row-major floats normalized to the unit length
+    std::vector<float> y(m * K);
+    for (std::size_t j = 0; j < m; ++j) {
+        double ss = 0.0;
+        for (std::size_t l = 0; l < K; ++l)
+            ss += y_(j, l) * y_(j, l);
+        double scale = 1.0 / std::sqrt(ss);
+        for (std::size_t l = 0; l < K; ++l)
+            y[j * K + l] = y_(j, l) * scale;
+    }
+    
+    const w2v::kernels_t &kernels = w2v::kernels();
+    
+    // top-k of each query in each thread
+    std::vector<std::vector<score_t>> heaps;
+    std::mutex mutex;
+    parallel_for(nrow, threads, [&](std::size_t from, std::size_t to) {
+        const std::size_t block = 64;
+        std::vector<float> rows(block * K);
+        std::vector<float> scales(block);
+        std::vector<std::vector<score_t>> local(m);
+        for (auto &heap : local)
+            heap.reserve(k + 1);
+        for (std::size_t i0 = from; i0 < to; i0 += block) {
+            std::size_t b = std::min(block, to - i0);
+            // convert a block of rows to floats; columns are read contiguously from double matrices
+            if (x.compact) {
+                for (std::size_t i = 0; i < b; ++i)
+                    x.get(i0 + i, rows.data() + i * K);
+            } else {
+                for (std::size_t l = 0; l < K; ++l) {
+                    const double *col = x.mat + l * nrow + i0;
+                    for (std::size_t i = 0; i < b; ++i)
+                        rows[i * K + l] = static_cast<float>(col[i]);
+                }
+            }
+            for (std::size_t i = 0; i < b; ++i)
+                scales[i] = 1.0f / std::sqrt(kernels.dot(rows.data() + i * K, rows.data() + i * K, K));
+            // each query is compared with the rows in the cache
+            for (std::size_t j = 0; j < m; ++j) {
+                auto &heap = local[j];
+                const float *q = y.data() + j * K;
+                for (std::size_t i = 0; i < b; ++i) {
+                    float s = kernels.dot(rows.data() + i * K, q, K) * scales[i];
+                    if (std::isnan(s))
+                        continue; // zero vectors
+                    score_t e(s, (int)(i0 + i));
+                    if (heap.size() < k) {
+                        heap.push_back(e);
+                        std::push_heap(heap.begin(), heap.end(), better); // worst on the top
+                    } else if (k > 0 && better(e, heap.front())) {
+                        std::pop_heap(heap.begin(), heap.end(), better);
+                        heap.back() = e;
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    }
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (heaps.empty()) {
+            heaps = std::move(local);
+        } else {
+            for (std::size_t j = 0; j < m; ++j)
+                heaps[j].insert(heaps[j].end(), local[j].begin(), local[j].end());
+        }
+    });
+    
+    // merge the heaps of the threads
+    Rcpp::IntegerMatrix index_(k, m);
+    Rcpp::NumericMatrix score_(k, m);
+    std::fill(index_.begin(), index_.end(), NA_INTEGER);
+    std::fill(score_.begin(), score_.end(), NA_REAL);
+    for (std::size_t j = 0; j < m && !heaps.empty(); ++j) {
+        auto &heap = heaps[j];
+        std::size_t h = std::min(k, heap.size());
+        std::partial_sort(heap.begin(), heap.begin() + h, heap.end(), better);
+        for (std::size_t i = 0; i < h; ++i) {
+            index_(i, j) = heap[i].second + 1;
+            score_(i, j) = heap[i].first;
+        }
+    }
+    return Rcpp::List::create(
+        Rcpp::Named("index") = index_,
+        Rcpp::Named("score") = score_
+    );
+}
@@ -0,0 +1,19 @@
+#ifndef WORDVECTOR_UTILITY_H
+#define WORDVECTOR_UTILITY_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// run fun(from, to) in parallel over n items
+template <typename F>
+inline void parallel_for(std::size_t n, int threads, F fun) {
+    std::size_t nthread = std::max<std::size_t>(std::min<std::size_t>(threads, n / 256), 1);
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < nthread; ++t)
+        workers.emplace_back(fun, n * t / nthread, n * (t + 1) / nthread);
+    for (auto &worker : workers)
+        worker.join();
+}
+
+#endif
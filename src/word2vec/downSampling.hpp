@@ -8,48 +8,56 @@
 #ifndef WORD2VEC_DOWNSAMPLING_H
 #define WORD2VEC_DOWNSAMPLING_H
 
-#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
 
 namespace w2v {
   /**
    * @brief downSampling class - randomly down-sampling frequent words
    *
-   * Randomly discard a frequent word from a training sentence
+   * Randomly discard a frequent word from a training sentence. The probabilities of keeping words
+   * are computed once for all the words and stored as 32-bit fixed-point thresholds, so that each
+   * word is tested by a lookup and a comparison with a random integer.
   */
   class downSampling_t {
   private:
-    const float m_sample;
-    const std::size_t m_trainWords;
-    const std::size_t m_unfrequentSince;
-    mutable std::uniform_real_distribution<float> m_freqWordsDistribution;
+    std::vector<uint32_t> m_thresholds; // words are kept if random integers do not exceed these
 
   public:
     /**
      * Constructs a downSampling object
      * @param _sample defines boundary of frequent words, small values (1e-5) make high boundary while
      * bigger values (1e-3) make low boundary
+     * @param _frequency frequency of words
      * @param _trainWords defines total train words in a corpus
      */
-    downSampling_t(float _sample, std::size_t _trainWords) :
-        m_sample(_sample), m_trainWords(_trainWords),
-        m_unfrequentSince(static_cast<std::size_t>((m_sample / (1.5f - 0.5f * std::sqrt(5.0f))) * m_trainWords)),
-        m_freqWordsDistribution(0.0f, 1.0f) {}
+    downSampling_t(float _sample, const std::vector<std::size_t> &_frequency, std::size_t _trainWords) :
+        m_thresholds(_frequency.size(), UINT32_MAX) {
+      for (std::size_t i = 0; i < _frequency.size(); ++i) {
+        if (_frequency[i] == 0)
+          continue;
+        double z = static_cast<double>(_frequency[i]) / _trainWords;
+        double keep = (std::sqrt(z / _sample) + 1) * _sample / z;
+        // kept with probability (threshold + 1) / 2^32
+        if (keep < 1.0)
+          m_thresholds[i] = static_cast<uint32_t>(std::max(keep * 4294967296.0 - 1.0, 0.0));
+      }
+    }
 
     /**
-     * Generates a random decision to discard a word with _wordFreq frequency from a train sentence
-     * @param _wordFreq word frequency
+     * Generates a random decision to discard a word from a train sentence
+     * @param _word zero-based index of the word
      * @param _randomGenerator random generator object instantiated outside of the downSampling object
      * @returns skip (true) or include (false) word into a training sentence
      */
-    inline bool operator()(std::size_t _wordFreq, std::mt19937_64 &_randomGenerator) const noexcept {
-      if (_wordFreq > m_unfrequentSince) {
-        float z = ((float) _wordFreq) / m_trainWords;
-        float dist = (std::sqrt(z / m_sample) + 1) * m_sample / z;
-        auto ret = dist < m_freqWordsDistribution(_randomGenerator);
-        return ret;
-      }
-
-      return false;
+    template <typename generator_t>
+    inline bool operator()(std::size_t _word, generator_t &_randomGenerator) const noexcept {
+      uint32_t threshold = m_thresholds[_word];
+      if (threshold == UINT32_MAX) // infrequent words are always kept
+        return false;
+      return static_cast<uint32_t>(_randomGenerator() >> 32) > threshold;
     }
   };
 }
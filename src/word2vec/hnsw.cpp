@@ -0,0 +1,369 @@
+/**
+ * @file
+ * @brief approximate nearest neighbour search of word or document vectors
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "hnsw.hpp"
+
+namespace w2v {
+    namespace {
+        typedef std::pair<float, uint32_t> candidate_t; // distance and index
+
+        const char magic[8] = {'W', '2', 'V', 'H', 'N', 'S', 'W', '1'};
+
+        // levels are capped far above those drawn in practice (probability of 2^-64 with M = 2)
+        const int levelMax = 64;
+
+        template <typename T>
+        void write(std::ostream &_out, const T *_data, std::size_t _n) {
+            _out.write(reinterpret_cast<const char*>(_data), sizeof(T) * _n);
+        }
+
+        template <typename T>
+        void read(std::istream &_in, T *_data, std::size_t _n) {
+            _in.read(reinterpret_cast<char*>(_data), sizeof(T) * _n);
+            if (!_in)
+                throw std::runtime_error("index file is truncated");
+        }
+
+        // @returns bytes from the current position to the end of the stream
+        std::size_t remaining(std::istream &_in) {
+            std::istream::pos_type pos = _in.tellg();
+            _in.seekg(0, std::ios::end);
+            std::istream::pos_type end = _in.tellg();
+            _in.seekg(pos);
+            if (!_in || pos == std::istream::pos_type(-1) || end < pos)
+                throw std::runtime_error("failed to read index file");
+            return static_cast<std::size_t>(end - pos);
+        }
+    }
+
+    hnsw_t::hnsw_t(): m_kernels(kernels()), m_locks(new std::mutex[m_nlocks]) {}
+
+    hnsw_t::hnsw_t(matrix_t &&_vectors, const params_t &_params, std::size_t _threads):
+        m_vectors(std::move(_vectors)), m_M(std::max<std::size_t>(_params.M, 2)), m_M0(m_M * 2),
+        m_efConstruction(std::max(_params.efConstruction, m_M)), m_kernels(kernels()),
+        m_locks(new std::mutex[m_nlocks]) {
+
+        std::size_t n = m_vectors.nrow();
+        if (n > UINT32_MAX)
+            throw std::runtime_error("too many vectors for an index");
+
+        // normalize vectors to the unit length; zero vectors remain zero
+        for (std::size_t i = 0; i < n; ++i) {
+            float *row = m_vectors.row(i);
+            float norm = std::sqrt(m_kernels.dot(row, row, m_vectors.stride()));
+            if (norm > 0.0f) {
+                for (std::size_t k = 0; k < m_vectors.ncol(); ++k)
+                    row[k] /= norm;
+            }
+        }
+
+        // levels drawn from an exponentially decaying distribution
+        std::mt19937_64 generator(_params.random);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        double mult = 1.0 / std::log(static_cast<double>(m_M));
+        m_levels.resize(n);
+        m_links.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            double level = -std::log(1.0 - uniform(generator)) * mult;
+            m_levels[i] = static_cast<uint8_t>(std::min(level, static_cast<double>(levelMax)));
+            if (m_levels[i] > 0)
+                m_links[i].resize(m_levels[i] * (m_M + 1));
+        }
+        m_links0.resize(n * (m_M0 + 1));
+        if (n == 0)
+            return;
+
+        // the first vector is the entry point of the other vectors
+        m_entry = 0;
+        m_maxLevel = m_levels[0];
+        std::atomic<std::size_t> next(1);
+        std::size_t nthread = std::max<std::size_t>(std::min(_threads, n / 1000), 1);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < nthread; ++t) {
+            threads.emplace_back([&] {
+                visited_t visited(n);
+                for (std::size_t i = next++; i < n; i = next++)
+                    insert(i, visited);
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    void hnsw_t::insert(std::size_t _i, visited_t &_visited) {
+
+        const float *query = m_vectors.row(_i);
+        int level = m_levels[_i];
+
+        // the thread that raises the top level holds the global lock until the end
+        std::unique_lock<std::mutex> global(m_global);
+        int maxLevel = m_maxLevel;
+        uint32_t entry = m_entry;
+        if (level <= maxLevel)
+            global.unlock();
+
+        entry = greedy(query, entry, maxLevel, level);
+        for (int l = std::min(level, maxLevel); l >= 0; --l) {
+            auto candidates = searchLayer(query, entry, m_efConstruction, l, _visited);
+            entry = candidates.front().second;
+            std::size_t Mmax = l == 0 ? m_M0 : m_M;
+            selectNeighbours(candidates, m_M);
+            {
+                std::lock_guard<std::mutex> guard(lock(_i));
+                uint32_t *links = this->links(_i, l);
+                links[0] = static_cast<uint32_t>(candidates.size());
+                for (std::size_t j = 0; j < candidates.size(); ++j)
+                    links[j + 1] = candidates[j].second;
+            }
+            // add the link to the neighbours, pruning their lists when full
+            for (const auto &c : candidates) {
+                std::lock_guard<std::mutex> guard(lock(c.second));
+                uint32_t *links = this->links(c.second, l);
+                if (links[0] < Mmax) {
+                    links[++links[0]] = static_cast<uint32_t>(_i);
+                    continue;
+                }
+                const float *row = m_vectors.row(c.second);
+                std::vector<candidate_t> neighbours;
+                neighbours.reserve(Mmax + 1);
+                neighbours.emplace_back(distance(row, query), static_cast<uint32_t>(_i));
+                for (std::size_t j = 1; j <= links[0]; ++j)
+                    neighbours.emplace_back(distance(row, m_vectors.row(links[j])), links[j]);
+                std::sort(neighbours.begin(), neighbours.end());
+                selectNeighbours(neighbours, Mmax);
+                links[0] = static_cast<uint32_t>(neighbours.size());
+                for (std::size_t j = 0; j < neighbours.size(); ++j)
+                    links[j + 1] = neighbours[j].second;
+            }
+        }
+
+        if (level > maxLevel) {
+            m_entry = static_cast<uint32_t>(_i);
+            m_maxLevel = level;
+        }
+    }
+
+    uint32_t hnsw_t::greedy(const float *_query, uint32_t _entry, int _from, int _to) const {
+
+        uint32_t current = _entry;
+        float best = distance(_query, m_vectors.row(current));
+        std::vector<uint32_t> neighbours;
+        for (int l = _from; l > _to; --l) {
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                {
+                    std::lock_guard<std::mutex> guard(lock(current));
+                    const uint32_t *links = this->links(current, l);
+                    neighbours.assign(links + 1, links + 1 + links[0]);
+                }
+                for (uint32_t j : neighbours) {
+                    float d = distance(_query, m_vectors.row(j));
+                    if (d < best) {
+                        best = d;
+                        current = j;
+                        changed = true;
+                    }
+                }
+            }
+        }
+        return current;
+    }
+
+    std::vector<candidate_t> hnsw_t::searchLayer(const float *_query, uint32_t _entry,
+                                                         std::size_t _ef, int _level,
+                                                         visited_t &_visited) const {
+
+        _visited.reset();
+        // closest candidates first and farthest results first
+        std::priority_queue<candidate_t, std::vector<candidate_t>, std::greater<candidate_t>> candidates;
+        std::priority_queue<candidate_t> results;
+
+        float d = distance(_query, m_vectors.row(_entry));
+        candidates.emplace(d, _entry);
+        results.emplace(d, _entry);
+        _visited.visit(_entry);
+
+        std::vector<uint32_t> neighbours;
+        while (!candidates.empty()) {
+            candidate_t c = candidates.top();
+            if (c.first > results.top().first && results.size() >= _ef)
+                break;
+            candidates.pop();
+            {
+                std::lock_guard<std::mutex> guard(lock(c.second));
+                const uint32_t *links = this->links(c.second, _level);
+                neighbours.assign(links + 1, links + 1 + links[0]);
+            }
+            for (uint32_t j : neighbours) {
+                if (_visited.visit(j))
+                    continue;
+                float dj = distance(_query, m_vectors.row(j));
+                if (results.size() < _ef || dj < results.top().first) {
+                    candidates.emplace(dj, j);
+                    results.emplace(dj, j);
+                    if (results.size() > _ef)
+                        results.pop();
+                }
+            }
+        }
+
+        std::vector<candidate_t> result(results.size());
+        for (std::size_t i = result.size(); i > 0; --i) {
+            result[i - 1] = results.top();
+            results.pop();
+        }
+        return result; // closest first
+    }
+
+    void hnsw_t::selectNeighbours(std::vector<candidate_t> &_candidates, std::size_t _M) const {
+
+        if (_candidates.size() <= _M)
+            return;
+        // keep candidates closer to the query than to the selected neighbours to connect clusters
+        std::vector<candidate_t> selected;
+        selected.reserve(_M);
+        for (const auto &c : _candidates) {
+            if (selected.size() >= _M)
+                break;
+            const float *row = m_vectors.row(c.second);
+            bool good = true;
+            for (const auto &s : selected) {
+                if (distance(row, m_vectors.row(s.second)) < c.first) {
+                    good = false;
+                    break;
+                }
+            }
+            if (good)
+                selected.push_back(c);
+        }
+        _candidates.swap(selected);
+    }
+
+    std::vector<hnsw_t::result_t> hnsw_t::search(const float *_query, std::size_t _k, std::size_t _ef,
+                                                 visited_t &_visited) const {
+
+        std::vector<result_t> result;
+        if (size() == 0 || _k == 0)
+            return result;
+
+        // padded and normalized query
+        std::vector<float> query(m_vectors.stride(), 0.0f);
+        std::copy_n(_query, ncol(), query.begin());
+        float norm = std::sqrt(m_kernels.dot(query.data(), query.data(), query.size()));
+        if (!(norm > 0.0f))
+            return result;
+        for (auto &q : query)
+            q /= norm;
+
+        uint32_t entry = greedy(query.data(), m_entry, m_maxLevel, 0);
+        auto candidates = searchLayer(query.data(), entry, std::max(_ef, _k), 0, _visited);
+        std::size_t k = std::min(_k, candidates.size());
+        result.reserve(k);
+        for (std::size_t i = 0; i < k; ++i)
+            result.emplace_back(1.0f - candidates[i].first, candidates[i].second);
+        return result;
+    }
+
+    void hnsw_t::save(std::ostream &_out) const {
+
+        uint64_t header[6] = {m_vectors.nrow(), m_vectors.ncol(), m_M, m_efConstruction,
+                              static_cast<uint64_t>(static_cast<int64_t>(m_maxLevel)), m_entry};
+        write(_out, magic, sizeof(magic));
+        write(_out, header, 6);
+        for (std::size_t i = 0; i < m_vectors.nrow(); ++i)
+            write(_out, m_vectors.row(i), m_vectors.ncol());
+        write(_out, m_levels.data(), m_levels.size());
+        write(_out, m_links0.data(), m_links0.size());
+        for (const auto &links : m_links)
+            write(_out, links.data(), links.size());
+        if (!_out)
+            throw std::runtime_error("failed to write index");
+    }
+
+    std::unique_ptr<hnsw_t> hnsw_t::load(std::istream &_in) {
+
+        char buffer[sizeof(magic)];
+        read(_in, buffer, sizeof(magic));
+        if (std::memcmp(buffer, magic, sizeof(magic)) != 0)
+            throw std::runtime_error("invalid index file");
+        uint64_t header[6];
+        read(_in, header, 6);
+
+        // sizes are checked against the rest of the file before memory is allocated
+        std::size_t n = header[0];
+        std::size_t ncol = header[1];
+        std::size_t M = header[2];
+        std::size_t efConstruction = header[3];
+        int64_t maxLevel = static_cast<int64_t>(header[4]);
+        std::size_t bytes = remaining(_in);
+        if (n > UINT32_MAX || ncol == 0 || ncol > INT32_MAX || M < 2 || M > INT32_MAX ||
+            efConstruction < M || efConstruction > INT32_MAX)
+            throw std::runtime_error("invalid index file");
+        if (n > 0 && (ncol > bytes / sizeof(float) / n || M * 2 + 1 > bytes / sizeof(uint32_t) / n))
+            throw std::runtime_error("invalid index file");
+        if (n == 0 ? maxLevel != -1 || header[5] != 0 : 
+                     maxLevel < 0 || maxLevel > levelMax || header[5] >= n)
+            throw std::runtime_error("invalid index file");
+
+        std::unique_ptr<hnsw_t> index(new hnsw_t());
+        index->m_vectors = matrix_t(n, ncol);
+        index->m_M = M;
+        index->m_M0 = M * 2;
+        index->m_efConstruction = efConstruction;
+        index->m_maxLevel = static_cast<int>(maxLevel);
+        index->m_entry = static_cast<uint32_t>(header[5]);
+
+        for (std::size_t i = 0; i < n; ++i)
+            read(_in, index->m_vectors.row(i), index->m_vectors.ncol());
+        index->m_levels.resize(n);
+        read(_in, index->m_levels.data(), n);
+        // the entry point is at the top level and the upper layers are stored in the rest
+        std::size_t upper = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (index->m_levels[i] > levelMax)
+                throw std::runtime_error("invalid index file");
+            upper += index->m_levels[i];
+        }
+        if (n > 0 && index->m_levels[index->m_entry] != index->m_maxLevel)
+            throw std::runtime_error("invalid index file");
+        index->m_links0.resize(n * (index->m_M0 + 1));
+        read(_in, index->m_links0.data(), index->m_links0.size());
+        if (upper > remaining(_in) / sizeof(uint32_t) / (M + 1))
+            throw std::runtime_error("index file is truncated");
+        index->m_links.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            index->m_links[i].resize(index->m_levels[i] * (index->m_M + 1));
+            read(_in, index->m_links[i].data(), index->m_links[i].size());
+        }
+
+        // links must refer to existing vectors in the same layer
+        for (std::size_t i = 0; i < n; ++i) {
+            for (int l = 0; l <= index->m_levels[i]; ++l) {
+                const uint32_t *links = index->links(i, l);
+                std::size_t Mmax = l == 0 ? index->m_M0 : index->m_M;
+                if (links[0] > Mmax)
+                    throw std::runtime_error("invalid index file");
+                for (std::size_t j = 1; j <= links[0]; ++j) {
+                    if (links[j] >= n || index->m_levels[links[j]] < l)
+                        throw std::runtime_error("invalid index file");
+                }
+            }
+        }
+        return index;
+    }
+}
@@ -0,0 +1,150 @@
+/**
+ * @file
+ * @brief approximate nearest neighbour search of word or document vectors
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#ifndef WORD2VEC_HNSW_H
+#define WORD2VEC_HNSW_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "kernels.hpp"
+#include "matrix.hpp"
+
+namespace w2v {
+    /**
+     * @brief hnsw class - hierarchical navigable small world graph of vectors
+     *
+     * Vectors are normalized to the unit length, so that the nearest neighbours have the highest
+     * cosine similarity. Each vector is linked to its close vectors in the bottom layer and in the
+     * layers up to a random level, and queries descend from the sparse top layer to the bottom
+     * (Malkov & Yashunin, 2018). Vectors are inserted by multiple threads that lock the lists of
+     * neighbours they modify.
+    */
+    class hnsw_t final {
+    public:
+        /**
+         * @brief parameters of the graph
+        */
+        struct params_t final {
+            std::size_t M = 16; ///< number of neighbours in the upper layers (twice in the bottom layer)
+            std::size_t efConstruction = 200; ///< number of candidates of neighbours in construction
+            uint64_t random = 1234; ///< random number seed for the levels of vectors
+        };
+
+        typedef std::pair<float, uint32_t> result_t; ///< similarity and index of a vector
+
+        /**
+         * @brief visited class - marks of visited vectors reused across searches
+        */
+        class visited_t final {
+        private:
+            std::vector<uint16_t> m_marks;
+            uint16_t m_mark = 0;
+        public:
+            explicit visited_t(std::size_t _size): m_marks(_size) {}
+            /// Clears the marks of the previous search
+            void reset() noexcept {
+                if (++m_mark == 0) {
+                    std::fill(m_marks.begin(), m_marks.end(), 0);
+                    m_mark = 1;
+                }
+            }
+            /// @returns true if the vector has been visited and marks it
+            bool visit(std::size_t _i) noexcept {
+                if (m_marks[_i] == m_mark)
+                    return true;
+                m_marks[_i] = m_mark;
+                return false;
+            }
+        };
+
+    private:
+        matrix_t m_vectors;
+        std::size_t m_M = 0;
+        std::size_t m_M0 = 0;
+        std::size_t m_efConstruction = 0;
+        std::vector<uint8_t> m_levels;
+        std::vector<uint32_t> m_links0; ///< number of neighbours followed by their indices in the bottom layer
+        std::vector<std::vector<uint32_t>> m_links; ///< the same in the upper layers of each vector
+        uint32_t m_entry = 0;
+        int m_maxLevel = -1;
+        const kernels_t &m_kernels;
+        // locks of lists of neighbours shared by vectors
+        static constexpr std::size_t m_nlocks = 65536;
+        std::unique_ptr<std::mutex[]> m_locks;
+        std::mutex m_global;
+
+    public:
+        hnsw_t();
+        /**
+         * Builds a graph of vectors
+         * @param _vectors vectors to be searched, normalized in place
+         * @param _params parameters of the graph
+         * @param _threads number of threads to insert vectors
+        */
+        hnsw_t(matrix_t &&_vectors, const params_t &_params, std::size_t _threads);
+
+        // copying prohibited
+        hnsw_t(const hnsw_t &) = delete;
+        void operator=(const hnsw_t &) = delete;
+
+        /**
+         * Finds the nearest neighbours of a vector
+         * @param _query vector of ncol() values
+         * @param _k number of neighbours
+         * @param _ef number of candidates; larger values improve recall but slow down the search
+         * @param _visited marks reused by the calling thread
+         * @returns neighbours sorted by similarity in descending order
+        */
+        std::vector<result_t> search(const float *_query, std::size_t _k, std::size_t _ef,
+                                     visited_t &_visited) const;
+
+        /// @returns normalized vector
+        const float *vector(std::size_t _i) const noexcept {return m_vectors.row(_i);}
+        std::size_t size() const noexcept {return m_vectors.nrow();}
+        std::size_t ncol() const noexcept {return m_vectors.ncol();}
+        std::size_t M() const noexcept {return m_M;}
+        std::size_t efConstruction() const noexcept {return m_efConstruction;}
+
+        /// Writes the graph in a binary format
+        void save(std::ostream &_out) const;
+        /**
+         * Reads a graph written by save()
+         * @throws std::runtime_error if the format is invalid
+        */
+        static std::unique_ptr<hnsw_t> load(std::istream &_in);
+
+    private:
+        inline float distance(const float *_x, const float *_y) const noexcept {
+            return 1.0f - m_kernels.dot(_x, _y, m_vectors.stride());
+        }
+        inline std::mutex &lock(std::size_t _i) const noexcept {return m_locks[_i % m_nlocks];}
+        inline uint32_t *links(std::size_t _i, int _level) noexcept {
+            if (_level == 0)
+                return m_links0.data() + _i * (m_M0 + 1);
+            return m_links[_i].data() + (_level - 1) * (m_M + 1);
+        }
+        inline const uint32_t *links(std::size_t _i, int _level) const noexcept {
+            return const_cast<hnsw_t*>(this)->links(_i, _level);
+        }
+
+        void insert(std::size_t _i, visited_t &_visited);
+        uint32_t greedy(const float *_query, uint32_t _entry, int _from, int _to) const;
+        std::vector<std::pair<float, uint32_t>> searchLayer(const float *_query, uint32_t _entry,
+                                                            std::size_t _ef, int _level,
+                                                            visited_t &_visited) const;
+        void selectNeighbours(std::vector<std::pair<float, uint32_t>> &_candidates,
+                              std::size_t _M) const;
+    };
+}
+
+#endif // WORD2VEC_HNSW_H
@@ -1,55 +1,77 @@
 /**
  * @file
- * @brief Huffman encoding tree implementation based on std::priority_queue
+ * @brief Huffman encoding tree implementation based on two queues
  * @author Max Fomichev
  * @date 19.12.2016
  * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
 */
 
-#include <vector>
-#include <queue>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
 
 #include "huffmanTree.hpp"
 
 namespace w2v {
-  void huffmanTree_t::buildTree(const std::vector<std::size_t> &_input, std::shared_ptr<node_t> &_tree) const {
-    std::priority_queue<std::shared_ptr<node_t>, std::vector<std::shared_ptr<node_t>>, nodeCmp_t> tree;
+    huffmanTree_t::huffmanTree_t(const std::vector<std::size_t> &_input): 
+        m_codes(), m_points(), m_offsets(_input.size() + 1, 0) {
+        
+        std::size_t n = _input.size();
+        if (n < 2) // the root is a leaf
+            return;
+        if (n > UINT32_MAX / 2)
+            throw std::range_error("too many nodes for Huffman tree");
 
-    for (std::size_t i = 0; i < _input.size(); ++i) {
-      tree.emplace(std::shared_ptr<leaf_t>(new leaf_t(i, _input[i])));
-    }
-    std::size_t branchID = 0;
-    while (tree.size() > 1) {
-      std::shared_ptr<node_t> left = tree.top();
-      tree.pop();
-
-      std::shared_ptr<node_t> right = tree.top();
-      tree.pop();
-
-      tree.emplace(std::shared_ptr<branch_t>(new branch_t(left, right, branchID++)));
-    }
-    _tree = tree.top();
-    tree.pop();
-  }
+        // leaves sorted by frequency in ascending order
+        std::vector<uint32_t> leaf(n);
+        std::iota(leaf.begin(), leaf.end(), 0);
+        std::stable_sort(leaf.begin(), leaf.end(), [&](uint32_t _a, uint32_t _b) {
+            return _input[_a] < _input[_b];
+        });
 
-  void huffmanTree_t::generateCodes(const std::shared_ptr<node_t> &_node,
-             const huffmanCode_t &_code,
-             const huffmanPoint_t &_point) {
-    if (const leaf_t *leaf = dynamic_cast<const leaf_t *>(_node.get())) {
-      m_tree[leaf->m_index] = huffmanData_t(_code, _point);
+        // nodes 0 to n - 1 are leaves in sorted order and n to 2n - 2 are branches;
+        // branches are created in ascending order of frequency, so the two smallest nodes
+        // are always at the heads of the leaf queue and the branch queue
+        std::size_t m = 2 * n - 1;
+        std::vector<std::size_t> frequency(m);
+        std::vector<uint32_t> parent(m);
+        std::vector<uint8_t> binary(m, 0);
+        for (std::size_t i = 0; i < n; ++i)
+            frequency[i] = _input[leaf[i]];
+        std::size_t l = 0, b = n;
+        for (std::size_t i = n; i < m; ++i) {
+            std::size_t min[2];
+            for (auto &j : min) {
+                if (l < n && (b == i || frequency[l] <= frequency[b])) {
+                    j = l++;
+                } else {
+                    j = b++;
+                }
+            }
+            frequency[i] = frequency[min[0]] + frequency[min[1]];
+            parent[min[0]] = static_cast<uint32_t>(i);
+            parent[min[1]] = static_cast<uint32_t>(i);
+            binary[min[1]] = 1;
+        }
 
-    }  else if (const branch_t *branch = dynamic_cast<const branch_t *>(_node.get())) {
-      auto leftPrefix = _code;
-      leftPrefix.push_back(false);
-      auto leftPoint = _point;
-      leftPoint.push_back(branch->m_id);
-      generateCodes(branch->m_left, leftPrefix, leftPoint);
+        // depth of nodes from the root
+        std::vector<uint32_t> depth(m, 0);
+        for (std::size_t i = m - 1; i-- > 0;)
+            depth[i] = depth[parent[i]] + 1;
+        for (std::size_t i = 0; i < n; ++i)
+            m_offsets[leaf[i] + 1] = depth[i];
+        std::partial_sum(m_offsets.begin(), m_offsets.end(), m_offsets.begin());
 
-      auto rightPrefix = _code;
-      rightPrefix.push_back(true);
-      auto rightPoint = _point;
-      rightPoint.push_back(branch->m_id);
-      generateCodes(branch->m_right, rightPrefix, rightPoint);
+        // codes and branch IDs from the root to the leaves
+        m_codes.resize(m_offsets[n]);
+        m_points.resize(m_offsets[n]);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::size_t pos = m_offsets[leaf[i] + 1];
+            for (std::size_t j = i; j != m - 1; j = parent[j]) {
+                --pos;
+                m_codes[pos] = binary[j];
+                m_points[pos] = static_cast<uint32_t>(parent[j] - n);
+            }
+        }
     }
-  }
 }
@@ -0,0 +1,410 @@
+/**
+ * @file
+ * @brief vector kernels used by the training threads
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#include "kernels.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define W2V_X86
+#include <immintrin.h>
+// MinGW does not align the stack to 32 bytes, so AVX code is not safe on Windows
+#if !defined(_WIN32)
+#define W2V_AVX
+#endif
+#endif
+
+namespace w2v {
+    namespace {
+        // Kernels are instantiated for vectors of any length (N = 0) and for the padded lengths of
+        // the common dimensions, which are multiples of 16, so their loops are unrolled by the
+        // compiler and the loops for the remainders are removed.
+
+        /* ---- portable C++ ------------------------- */
+
+        template <std::size_t N>
+        float dotGeneric(const float *_x, const float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+            std::size_t k = 0;
+            for (; k + 4 <= n; k += 4) {
+                s0 += _x[k] * _y[k];
+                s1 += _x[k + 1] * _y[k + 1];
+                s2 += _x[k + 2] * _y[k + 2];
+                s3 += _x[k + 3] * _y[k + 3];
+            }
+            for (; N == 0 && k < n; ++k)
+                s0 += _x[k] * _y[k];
+            return (s0 + s1) + (s2 + s3);
+        }
+
+        template <std::size_t N>
+        void axpyGeneric(float _a, const float *_x, float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            for (std::size_t k = 0; k < n; ++k)
+                _y[k] += _a * _x[k];
+        }
+
+        template <std::size_t N>
+        void dualAxpyGeneric(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            for (std::size_t k = 0; k < n; ++k) {
+                float y = _y[k];
+                _z[k] += _a * y;
+                _y[k] = y + _a * _x[k];
+            }
+        }
+
+        template <std::size_t N>
+        void scaleGeneric(float _a, const float *_x, float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            for (std::size_t k = 0; k < n; ++k)
+                _y[k] = _a * _x[k];
+        }
+
+        template <std::size_t N>
+        void dualScaleAxpyGeneric(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            for (std::size_t k = 0; k < n; ++k) {
+                float y = _y[k];
+                _z[k] = _a * y;
+                _y[k] = y + _a * _x[k];
+            }
+        }
+
+#ifdef W2V_X86
+
+        /* ---- SSE ------------------------- */
+
+        template <std::size_t N>
+        __attribute__((target("sse2")))
+        float dotSse(const float *_x, const float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m128 s0 = _mm_setzero_ps();
+            __m128 s1 = _mm_setzero_ps();
+            std::size_t k = 0;
+            for (; k + 8 <= n; k += 8) {
+                s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(_x + k), _mm_loadu_ps(_y + k)));
+                s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(_x + k + 4), _mm_loadu_ps(_y + k + 4)));
+            }
+            for (; k + 4 <= n; k += 4)
+                s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(_x + k), _mm_loadu_ps(_y + k)));
+            s0 = _mm_add_ps(s0, s1);
+            s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+            s0 = _mm_add_ss(s0, _mm_shuffle_ps(s0, s0, 1));
+            float s = _mm_cvtss_f32(s0);
+            for (; N == 0 && k < n; ++k)
+                s += _x[k] * _y[k];
+            return s;
+        }
+
+        template <std::size_t N>
+        __attribute__((target("sse2")))
+        void axpySse(float _a, const float *_x, float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m128 a = _mm_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 4 <= n; k += 4)
+                _mm_storeu_ps(_y + k, _mm_add_ps(_mm_loadu_ps(_y + k), _mm_mul_ps(a, _mm_loadu_ps(_x + k))));
+            for (; N == 0 && k < n; ++k)
+                _y[k] += _a * _x[k];
+        }
+
+        template <std::size_t N>
+        __attribute__((target("sse2")))
+        void dualAxpySse(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m128 a = _mm_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 4 <= n; k += 4) {
+                __m128 y = _mm_loadu_ps(_y + k);
+                _mm_storeu_ps(_z + k, _mm_add_ps(_mm_loadu_ps(_z + k), _mm_mul_ps(a, y)));
+                _mm_storeu_ps(_y + k, _mm_add_ps(y, _mm_mul_ps(a, _mm_loadu_ps(_x + k))));
+            }
+            for (; N == 0 && k < n; ++k) {
+                float y = _y[k];
+                _z[k] += _a * y;
+                _y[k] = y + _a * _x[k];
+            }
+        }
+
+        template <std::size_t N>
+        __attribute__((target("sse2")))
+        void scaleSse(float _a, const float *_x, float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m128 a = _mm_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 4 <= n; k += 4)
+                _mm_storeu_ps(_y + k, _mm_mul_ps(a, _mm_loadu_ps(_x + k)));
+            for (; N == 0 && k < n; ++k)
+                _y[k] = _a * _x[k];
+        }
+
+        template <std::size_t N>
+        __attribute__((target("sse2")))
+        void dualScaleAxpySse(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m128 a = _mm_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 4 <= n; k += 4) {
+                __m128 y = _mm_loadu_ps(_y + k);
+                _mm_storeu_ps(_z + k, _mm_mul_ps(a, y));
+                _mm_storeu_ps(_y + k, _mm_add_ps(y, _mm_mul_ps(a, _mm_loadu_ps(_x + k))));
+            }
+            for (; N == 0 && k < n; ++k) {
+                float y = _y[k];
+                _z[k] = _a * y;
+                _y[k] = y + _a * _x[k];
+            }
+        }
+
+#endif
+#ifdef W2V_AVX
+
+        /* ---- AVX2 and FMA ------------------------- */
+
+        template <std::size_t N>
+        __attribute__((target("avx2,fma")))
+        float dotAvx2(const float *_x, const float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m256 s0 = _mm256_setzero_ps();
+            __m256 s1 = _mm256_setzero_ps();
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16) {
+                s0 = _mm256_fmadd_ps(_mm256_loadu_ps(_x + k), _mm256_loadu_ps(_y + k), s0);
+                s1 = _mm256_fmadd_ps(_mm256_loadu_ps(_x + k + 8), _mm256_loadu_ps(_y + k + 8), s1);
+            }
+            for (; k + 8 <= n; k += 8)
+                s0 = _mm256_fmadd_ps(_mm256_loadu_ps(_x + k), _mm256_loadu_ps(_y + k), s0);
+            s0 = _mm256_add_ps(s0, s1);
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+            float r = _mm_cvtss_f32(s);
+            for (; N == 0 && k < n; ++k)
+                r += _x[k] * _y[k];
+            return r;
+        }
+
+        template <std::size_t N>
+        __attribute__((target("avx2,fma")))
+        void axpyAvx2(float _a, const float *_x, float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m256 a = _mm256_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 8 <= n; k += 8)
+                _mm256_storeu_ps(_y + k, _mm256_fmadd_ps(a, _mm256_loadu_ps(_x + k), _mm256_loadu_ps(_y + k)));
+            for (; N == 0 && k < n; ++k)
+                _y[k] += _a * _x[k];
+        }
+
+        template <std::size_t N>
+        __attribute__((target("avx2,fma")))
+        void dualAxpyAvx2(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m256 a = _mm256_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 8 <= n; k += 8) {
+                __m256 y = _mm256_loadu_ps(_y + k);
+                _mm256_storeu_ps(_z + k, _mm256_fmadd_ps(a, y, _mm256_loadu_ps(_z + k)));
+                _mm256_storeu_ps(_y + k, _mm256_fmadd_ps(a, _mm256_loadu_ps(_x + k), y));
+            }
+            for (; N == 0 && k < n; ++k) {
+                float y = _y[k];
+                _z[k] += _a * y;
+                _y[k] = y + _a * _x[k];
+            }
+        }
+
+        template <std::size_t N>
+        __attribute__((target("avx2,fma")))
+        void scaleAvx2(float _a, const float *_x, float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m256 a = _mm256_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 8 <= n; k += 8)
+                _mm256_storeu_ps(_y + k, _mm256_mul_ps(a, _mm256_loadu_ps(_x + k)));
+            for (; N == 0 && k < n; ++k)
+                _y[k] = _a * _x[k];
+        }
+
+        template <std::size_t N>
+        __attribute__((target("avx2,fma")))
+        void dualScaleAxpyAvx2(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m256 a = _mm256_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 8 <= n; k += 8) {
+                __m256 y = _mm256_loadu_ps(_y + k);
+                _mm256_storeu_ps(_z + k, _mm256_mul_ps(a, y));
+                _mm256_storeu_ps(_y + k, _mm256_fmadd_ps(a, _mm256_loadu_ps(_x + k), y));
+            }
+            for (; N == 0 && k < n; ++k) {
+                float y = _y[k];
+                _z[k] = _a * y;
+                _y[k] = y + _a * _x[k];
+            }
+        }
+
+        /* ---- AVX-512 ------------------------- */
+
+        template <std::size_t N>
+        __attribute__((target("avx512f")))
+        float dotAvx512(const float *_x, const float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m512 s0 = _mm512_setzero_ps();
+            __m512 s1 = _mm512_setzero_ps();
+            std::size_t k = 0;
+            for (; k + 32 <= n; k += 32) {
+                s0 = _mm512_fmadd_ps(_mm512_loadu_ps(_x + k), _mm512_loadu_ps(_y + k), s0);
+                s1 = _mm512_fmadd_ps(_mm512_loadu_ps(_x + k + 16), _mm512_loadu_ps(_y + k + 16), s1);
+            }
+            for (; k + 16 <= n; k += 16)
+                s0 = _mm512_fmadd_ps(_mm512_loadu_ps(_x + k), _mm512_loadu_ps(_y + k), s0);
+            if (k < n) {
+                __mmask16 m = static_cast<__mmask16>((1u << (n - k)) - 1);
+                s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, _x + k), _mm512_maskz_loadu_ps(m, _y + k), s1);
+            }
+            float buf[16];
+            _mm512_storeu_ps(buf, _mm512_add_ps(s0, s1));
+            float s = 0.0f;
+            for (std::size_t i = 0; i < 16; ++i)
+                s += buf[i];
+            return s;
+        }
+
+        template <std::size_t N>
+        __attribute__((target("avx512f")))
+        void axpyAvx512(float _a, const float *_x, float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m512 a = _mm512_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16)
+                _mm512_storeu_ps(_y + k, _mm512_fmadd_ps(a, _mm512_loadu_ps(_x + k), _mm512_loadu_ps(_y + k)));
+            if (k < n) {
+                __mmask16 m = static_cast<__mmask16>((1u << (n - k)) - 1);
+                __m512 y = _mm512_maskz_loadu_ps(m, _y + k);
+                _mm512_mask_storeu_ps(_y + k, m, _mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(m, _x + k), y));
+            }
+        }
+
+        template <std::size_t N>
+        __attribute__((target("avx512f")))
+        void dualAxpyAvx512(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m512 a = _mm512_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16) {
+                __m512 y = _mm512_loadu_ps(_y + k);
+                _mm512_storeu_ps(_z + k, _mm512_fmadd_ps(a, y, _mm512_loadu_ps(_z + k)));
+                _mm512_storeu_ps(_y + k, _mm512_fmadd_ps(a, _mm512_loadu_ps(_x + k), y));
+            }
+            if (k < n) {
+                __mmask16 m = static_cast<__mmask16>((1u << (n - k)) - 1);
+                __m512 y = _mm512_maskz_loadu_ps(m, _y + k);
+                _mm512_mask_storeu_ps(_z + k, m, _mm512_fmadd_ps(a, y, _mm512_maskz_loadu_ps(m, _z + k)));
+                _mm512_mask_storeu_ps(_y + k, m, _mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(m, _x + k), y));
+            }
+        }
+
+        template <std::size_t N>
+        __attribute__((target("avx512f")))
+        void scaleAvx512(float _a, const float *_x, float *_y, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m512 a = _mm512_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16)
+                _mm512_storeu_ps(_y + k, _mm512_mul_ps(a, _mm512_loadu_ps(_x + k)));
+            if (k < n) {
+                __mmask16 m = static_cast<__mmask16>((1u << (n - k)) - 1);
+                _mm512_mask_storeu_ps(_y + k, m, _mm512_mul_ps(a, _mm512_maskz_loadu_ps(m, _x + k)));
+            }
+        }
+
+        template <std::size_t N>
+        __attribute__((target("avx512f")))
+        void dualScaleAxpyAvx512(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept {
+            const std::size_t n = N ? N : _n;
+            __m512 a = _mm512_set1_ps(_a);
+            std::size_t k = 0;
+            for (; k + 16 <= n; k += 16) {
+                __m512 y = _mm512_loadu_ps(_y + k);
+                _mm512_storeu_ps(_z + k, _mm512_mul_ps(a, y));
+                _mm512_storeu_ps(_y + k, _mm512_fmadd_ps(a, _mm512_loadu_ps(_x + k), y));
+            }
+            if (k < n) {
+                __mmask16 m = static_cast<__mmask16>((1u << (n - k)) - 1);
+                __m512 y = _mm512_maskz_loadu_ps(m, _y + k);
+                _mm512_mask_storeu_ps(_z + k, m, _mm512_mul_ps(a, y));
+                _mm512_mask_storeu_ps(_y + k, m, _mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(m, _x + k), y));
+            }
+        }
+
+#endif
+
+        /// padded lengths of 32, 50, 64, 100, 128, 200 and 300 dimensions (see matrix_t)
+        const std::size_t lengths[] = {32, 64, 112, 128, 208, 304};
+
+#define W2V_KERNELS(isa, name, N) \
+    {dot##isa<N>, axpy##isa<N>, dualAxpy##isa<N>, scale##isa<N>, dualScaleAxpy##isa<N>, name, N}
+#define W2V_TABLE(isa, name) { \
+    W2V_KERNELS(isa, name, 0), W2V_KERNELS(isa, name, 32), W2V_KERNELS(isa, name, 64), \
+    W2V_KERNELS(isa, name, 112), W2V_KERNELS(isa, name, 128), W2V_KERNELS(isa, name, 208), \
+    W2V_KERNELS(isa, name, 304)}
+
+        const kernels_t *find(const kernels_t *_table, std::size_t _n) noexcept {
+            for (std::size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+                if (lengths[i] == _n)
+                    return &_table[i + 1];
+            }
+            return &_table[0];
+        }
+
+        const kernels_t &select() noexcept {
+            for (const char *name : {"avx512", "avx2", "sse"}) {
+                if (const kernels_t *k = kernels(name))
+                    return *k;
+            }
+            return *kernels("generic");
+        }
+    }
+
+    const kernels_t *kernels(const std::string &_name, std::size_t _n) noexcept {
+        static const kernels_t generic[] = W2V_TABLE(Generic, "generic");
+        if (_name == "generic")
+            return find(generic, _n);
+#ifdef W2V_X86
+        __builtin_cpu_init();
+        if (_name == "sse" && __builtin_cpu_supports("sse2")) {
+            static const kernels_t sse[] = W2V_TABLE(Sse, "sse");
+            return find(sse, _n);
+        }
+#endif
+#ifdef W2V_AVX
+        if (_name == "avx2" && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            static const kernels_t avx2[] = W2V_TABLE(Avx2, "avx2");
+            return find(avx2, _n);
+        }
+        if (_name == "avx512" && __builtin_cpu_supports("avx512f")) {
+            static const kernels_t avx512[] = W2V_TABLE(Avx512, "avx512");
+            return find(avx512, _n);
+        }
+#endif
+        return nullptr;
+    }
+
+#undef W2V_TABLE
+#undef W2V_KERNELS
+
+    const kernels_t &kernels() noexcept {
+        static const kernels_t &best = select();
+        return best;
+    }
+
+    const kernels_t &kernels(std::size_t _n) noexcept {
+        return *kernels(kernels().name, _n);
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * @file
+ * @brief vector kernels used by the training threads
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#ifndef WORD2VEC_KERNELS_H
+#define WORD2VEC_KERNELS_H
+
+#include <cstddef>
+#include <string>
+
+namespace w2v {
+    /**
+     * @brief kernels structure - a table of vector operations for one instruction set
+     *
+     * All the vector arithmetic in the inner loops of training goes through this table. The best
+     * implementation supported by the CPU is selected at runtime (AVX-512, AVX2/FMA or SSE on x86,
+     * portable C++ elsewhere), so the package can be compiled without machine-specific flags.
+    */
+    struct kernels_t final {
+        /// @returns sum of _x[k] * _y[k]
+        float (*dot)(const float *_x, const float *_y, std::size_t _n) noexcept;
+        /// _y[k] += _a * _x[k]
+        void (*axpy)(float _a, const float *_x, float *_y, std::size_t _n) noexcept;
+        /// _z[k] += _a * _y[k] and then _y[k] += _a * _x[k] in a single pass
+        void (*dualAxpy)(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept;
+        /// _y[k] = _a * _x[k], which initializes _y without clearing it first
+        void (*scale)(float _a, const float *_x, float *_y, std::size_t _n) noexcept;
+        /// _z[k] = _a * _y[k] and then _y[k] += _a * _x[k] in a single pass
+        void (*dualScaleAxpy)(float _a, const float *_x, float *_y, float *_z, std::size_t _n) noexcept;
+        const char *name; ///< name of the instruction set
+        std::size_t length; ///< length of the vectors for which the kernels are compiled, or 0 for any
+    };
+
+    /// @returns kernels for the best instruction set supported by the CPU
+    const kernels_t &kernels() noexcept;
+
+    /**
+     * Returns kernels for the best instruction set specialized for vectors of a length
+     *
+     * Kernels are compiled for the padded lengths of 32, 50, 64, 100, 128, 200 and 300 dimensions.
+     * The specialized kernels must be called only with vectors of that length.
+     * @param _n length of the vectors (stride of the matrices)
+     * @returns specialized kernels or kernels for any length if the length is not common
+     */
+    const kernels_t &kernels(std::size_t _n) noexcept;
+
+    /**
+     * Returns kernels for a specific instruction set
+     * @param _name "avx512", "avx2", "sse" or "generic"
+     * @param _n length of the vectors for the specialized kernels, or 0 for any length
+     * @returns pointer to the kernels or nullptr if the instruction set is not supported
+     */
+    const kernels_t *kernels(const std::string &_name, std::size_t _n = 0) noexcept;
+}
+
+#endif // WORD2VEC_KERNELS_H
@@ -0,0 +1,91 @@
+/**
+ * @file
+ * @brief dense matrix of word or document vectors
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "matrix.hpp"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace w2v {
+    matrix_t::matrix_t(std::size_t _nrow, std::size_t _ncol, bool _hugePages):
+        m_nrow(_nrow), m_ncol(_ncol), m_stride(stride(_ncol)) {
+
+        m_bytes = m_nrow * m_stride * sizeof(float);
+        if (m_bytes == 0)
+            return;
+
+#if defined(__linux__)
+        const std::size_t hugePageSize = 2 * 1024 * 1024;
+        if (_hugePages && m_bytes >= hugePageSize) {
+            // explicit huge pages are available only when reserved by the system administrator
+#ifdef MAP_HUGETLB
+            std::size_t bytes = (m_bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+            void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (ptr != MAP_FAILED) {
+                m_data = static_cast<float*>(ptr);
+                m_bytes = bytes;
+                m_mapped = true;
+                return;
+            }
+#endif
+            // otherwise, ask the kernel for transparent huge pages
+            void *ptr2 = mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr2 == MAP_FAILED)
+                throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+            madvise(ptr2, m_bytes, MADV_HUGEPAGE);
+#endif
+            m_data = static_cast<float*>(ptr2); // zero-filled by the kernel
+            m_mapped = true;
+            return;
+        }
+#endif
+        m_data = static_cast<float*>(::operator new(m_bytes, std::align_val_t(alignment)));
+        std::memset(m_data, 0, m_bytes);
+    }
+
+    matrix_t::~matrix_t() {
+        if (!m_data)
+            return;
+#if defined(__linux__)
+        if (m_mapped) {
+            munmap(m_data, m_bytes);
+            return;
+        }
+#endif
+        ::operator delete(m_data, std::align_val_t(alignment));
+    }
+
+    matrix_t::matrix_t(matrix_t &&_other) noexcept:
+        m_data(std::exchange(_other.m_data, nullptr)),
+        m_nrow(std::exchange(_other.m_nrow, 0)),
+        m_ncol(std::exchange(_other.m_ncol, 0)),
+        m_stride(std::exchange(_other.m_stride, 0)),
+        m_bytes(std::exchange(_other.m_bytes, 0)),
+        m_mapped(std::exchange(_other.m_mapped, false)) {}
+
+    matrix_t &matrix_t::operator=(matrix_t &&_other) noexcept {
+        if (this != &_other) {
+            matrix_t tmp(std::move(_other));
+            std::swap(m_data, tmp.m_data);
+            std::swap(m_nrow, tmp.m_nrow);
+            std::swap(m_ncol, tmp.m_ncol);
+            std::swap(m_stride, tmp.m_stride);
+            std::swap(m_bytes, tmp.m_bytes);
+            std::swap(m_mapped, tmp.m_mapped);
+        }
+        return *this;
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @brief dense matrix of word or document vectors
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#ifndef WORD2VEC_MATRIX_H
+#define WORD2VEC_MATRIX_H
+
+#include <cstddef>
+
+namespace w2v {
+    /**
+     * @brief matrix class - row-major matrix of vectors in contiguous aligned memory
+     *
+     * Rows start at 64-byte boundaries and are padded with zeros up to a multiple of 16 floats, so that
+     * the vector kernels can process whole rows without remainders. Large matrices can be backed by huge
+     * pages on Linux to reduce TLB misses when rows are accessed randomly.
+    */
+    class matrix_t final {
+    private:
+        float *m_data = nullptr;
+        std::size_t m_nrow = 0;
+        std::size_t m_ncol = 0;
+        std::size_t m_stride = 0;
+        std::size_t m_bytes = 0;
+        bool m_mapped = false; ///< allocated by mmap()
+
+    public:
+        static constexpr std::size_t alignment = 64; ///< alignment of rows in bytes
+
+        /// @returns number of floats in a row including padding
+        static std::size_t stride(std::size_t _ncol) noexcept {
+            std::size_t width = alignment / sizeof(float);
+            return (_ncol + width - 1) / width * width;
+        }
+
+        matrix_t() = default;
+        /**
+         * Constructs a matrix filled with zeros
+         * @param _nrow number of rows
+         * @param _ncol number of columns
+         * @param _hugePages allocate memory from huge pages if possible
+         * @throws std::bad_alloc if memory is not allocated
+         */
+        matrix_t(std::size_t _nrow, std::size_t _ncol, bool _hugePages = false);
+        ~matrix_t();
+
+        // copying prohibited
+        matrix_t(const matrix_t &) = delete;
+        void operator=(const matrix_t &) = delete;
+        matrix_t(matrix_t &&_other) noexcept;
+        matrix_t &operator=(matrix_t &&_other) noexcept;
+
+        inline float *row(std::size_t _i) noexcept {return m_data + _i * m_stride;}
+        inline const float *row(std::size_t _i) const noexcept {return m_data + _i * m_stride;}
+
+        std::size_t nrow() const noexcept {return m_nrow;}
+        std::size_t ncol() const noexcept {return m_ncol;}
+        std::size_t stride() const noexcept {return m_stride;}
+        bool empty() const noexcept {return m_nrow == 0 || m_ncol == 0;}
+    };
+}
+
+#endif // WORD2VEC_MATRIX_H
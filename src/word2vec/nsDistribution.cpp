@@ -1,33 +1,67 @@
 /**
  * @file
- * @brief linear subintervals random distribution class
+ * @brief alias table random distribution class
  * @author Max Fomichev
  * @date 02.02.2017
  * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
 */
 
-#include <vector>
 #include <cmath>
+#include <stdexcept>
 
 #include "nsDistribution.hpp"
 
 namespace w2v {
-    nsDistribution_t::nsDistribution_t(const std::vector<std::size_t> &_input): m_nsDistribution() {
-        std::vector<std::size_t> intervals;
-        std::vector<std::size_t> weights;
-        std::size_t prvFreq = 0;
-
-        for (std::size_t i = 1; i < _input.size(); ++i) {
-            float rms = std::sqrt((prvFreq * prvFreq + _input[i] * _input[i]) / 2.0f); // root mean square
-            if ((_input[i] < rms / 1.3f) || (_input[i] > rms * 1.3f)) {
-                intervals.push_back(i);
-                weights.push_back(static_cast<std::size_t>(std::pow(_input[i], 0.75))); // raise to 3/4
-                prvFreq = _input[i];
+    nsDistribution_t::nsDistribution_t(const std::vector<std::size_t> &_input, float _power): 
+        m_threshold(_input.size(), 0), m_alias(_input.size(), 0) {
+        
+        std::size_t n = _input.size();
+        if (n == 0 || n > UINT32_MAX)
+            throw std::range_error("invalid size of negative sampling distribution");
+        
+        // probabilities scaled to the average of 1.0
+        std::vector<double> prob(n);
+        double sum = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            prob[i] = std::pow(static_cast<double>(_input[i]), _power);
+            sum += prob[i];
+        }
+        if (sum <= 0.0)
+            throw std::range_error("invalid frequency of negative sampling distribution");
+        for (std::size_t i = 0; i < n; ++i)
+            prob[i] = prob[i] * n / sum;
+        
+        // Vose's alias method
+        std::vector<uint32_t> small, large;
+        small.reserve(n);
+        large.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (prob[i] < 1.0) {
+                small.push_back(static_cast<uint32_t>(i));
+            } else {
+                large.push_back(static_cast<uint32_t>(i));
             }
         }
-
-        m_nsDistribution.reset(new std::piecewise_linear_distribution<float>(intervals.begin(),
-                                                                             intervals.end(),
-                                                                             weights.begin()));
+        while (!small.empty() && !large.empty()) {
+            uint32_t s = small.back();
+            small.pop_back();
+            uint32_t l = large.back();
+            m_threshold[s] = static_cast<uint32_t>(std::ldexp(prob[s], 32));
+            m_alias[s] = l;
+            prob[l] = (prob[l] + prob[s]) - 1.0;
+            if (prob[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // remaining columns are full except for rounding errors
+        for (auto i : large) {
+            m_threshold[i] = UINT32_MAX;
+            m_alias[i] = i;
+        }
+        for (auto i : small) {
+            m_threshold[i] = UINT32_MAX;
+            m_alias[i] = i;
+        }
     }
 }
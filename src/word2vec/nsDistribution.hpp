@@ -1,6 +1,6 @@
 /**
  * @file
- * @brief linear subintervals random distribution class
+ * @brief alias table random distribution class
  * @author Max Fomichev
  * @date 02.02.2017
  * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
@@ -9,33 +9,44 @@
 #ifndef WORD2VEC_NSDISTRIBUTION_H
 #define WORD2VEC_NSDISTRIBUTION_H
 
-#include <memory>
+#include <cstdint>
 #include <random>
+#include <vector>
 
 namespace w2v {
     /**
-     * @brief nsDistribution class - linear subintervals random distribution
+     * @brief nsDistribution class - alias table random distribution
      *
-     * Generates a random value based on a sequence of subintervals bounds with different probability densities.
+     * Generates a random index with probability proportional to its frequency powered by a constant.
+     * Walker's alias method (Vose's variant) makes the sampling O(1) and exact: an index is chosen
+     * uniformly and then either kept or replaced by its alias by a biased coin.
     */
     class nsDistribution_t final {
     private:
-        std::unique_ptr<std::piecewise_linear_distribution<float>> m_nsDistribution;
+        std::vector<uint32_t> m_threshold; ///< probability of keeping the index in 32-bit fixed point
+        std::vector<uint32_t> m_alias; ///< index returned otherwise
 
     public:
         /**
-         * Constructs a nsDistribution object with approximated probability densities powered 0.75
-         * @param _input vector of probability densities for their indexes
+         * Constructs a nsDistribution object with probability densities powered by _power
+         * @param _input vector of frequencies for their indexes
+         * @param _power exponent applied to the frequencies
          */
-        explicit nsDistribution_t(const std::vector<std::size_t> &_input);
+        explicit nsDistribution_t(const std::vector<std::size_t> &_input, float _power = 0.75f);
 
         /**
-         * Generates a random value inside of subintervals bounds
+         * Generates a random index
          * @param _randomGenerator random generator object instantiated outside of the nsDistribution object
-         * @returns a random value
+         * @returns a random index
          */
-        inline std::size_t operator()(std::mt19937_64 &_randomGenerator) const noexcept {
-            return static_cast<std::size_t>((*m_nsDistribution)(_randomGenerator));
+        template <typename generator_t>
+        inline std::size_t operator()(generator_t &_randomGenerator) const noexcept {
+            uint64_t r = _randomGenerator();
+            // upper 32 bits choose a column and lower 32 bits flip the coin
+            std::size_t i = static_cast<std::size_t>(((r >> 32) * m_threshold.size()) >> 32);
+            if (static_cast<uint32_t>(r) < m_threshold[i])
+                return i;
+            return m_alias[i];
         }
     };
 }
@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @brief random number generator for the train threads
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#ifndef WORD2VEC_RANDOM_H
+#define WORD2VEC_RANDOM_H
+
+#include <cstdint>
+
+namespace w2v {
+    /**
+     * @brief random class - xoshiro256++ generator with streams derived from a seed
+     *
+     * The generator has 32 bytes of state and produces a 64-bit integer in a few instructions. Its
+     * state is derived from a seed and a stream number by SplitMix64, so that independent sequences
+     * are drawn for different streams, such as chunks of documents in epochs, without sharing state.
+     * Blackman, D., & Vigna, S. (2021). Scrambled linear pseudorandom number generators. ACM
+     * Transactions on Mathematical Software, 47(4), 1–32.
+     */
+    class random_t final {
+    private:
+        uint64_t m_state[4];
+
+        static inline uint64_t rotl(uint64_t _x, int _k) noexcept {
+            return (_x << _k) | (_x >> (64 - _k));
+        }
+
+        static inline uint64_t splitmix(uint64_t &_x) noexcept {
+            uint64_t z = (_x += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            return z ^ (z >> 31);
+        }
+
+    public:
+        typedef uint64_t result_type;
+
+        explicit random_t(uint64_t _seed = 0, uint64_t _stream = 0) noexcept {seed(_seed, _stream);}
+
+        /// Starts the sequence of a stream
+        void seed(uint64_t _seed, uint64_t _stream = 0) noexcept {
+            uint64_t x = _seed;
+            uint64_t y = splitmix(x) ^ _stream;
+            for (auto &s : m_state)
+                s = splitmix(y);
+        }
+
+        static constexpr result_type min() noexcept {return 0;}
+        static constexpr result_type max() noexcept {return UINT64_MAX;}
+
+        /// @returns a random 64-bit integer
+        inline result_type operator()() noexcept {
+            uint64_t result = rotl(m_state[0] + m_state[3], 23) + m_state[0];
+            uint64_t t = m_state[1] << 17;
+            m_state[2] ^= m_state[0];
+            m_state[3] ^= m_state[1];
+            m_state[1] ^= m_state[2];
+            m_state[0] ^= m_state[3];
+            m_state[2] ^= t;
+            m_state[3] = rotl(m_state[3], 45);
+            return result;
+        }
+
+        /**
+         * Generates a random integer in a range by multiplication instead of division
+         * @returns a random integer between 0 and _n - 1 without bias (Lemire, 2019)
+         */
+        inline uint32_t bounded(uint32_t _n) noexcept {
+            uint64_t m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * _n;
+            uint32_t l = static_cast<uint32_t>(m);
+            if (l < _n) {
+                uint32_t t = (0u - _n) % _n;
+                while (l < t) {
+                    m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * _n;
+                    l = static_cast<uint32_t>(m);
+                }
+            }
+            return static_cast<uint32_t>(m >> 32);
+        }
+    };
+}
+
+#endif // WORD2VEC_RANDOM_H
@@ -0,0 +1,124 @@
+/**
+ * @file
+ * @brief replica holds copies of the rows of a matrix updated by a train thread
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#ifndef WORD2VEC_REPLICA_H
+#define WORD2VEC_REPLICA_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "matrix.hpp"
+
+namespace w2v {
+    /**
+     * @brief replica class - copies of the rows of a shared matrix updated in a round
+     *
+     * In deterministic training, the shared matrices are only read while the threads train models
+     * on their chunks of documents. A thread copies rows when it uses them for the first time in a
+     * round and updates only the copies. At the end of the round, the copies are changed to their
+     * differences from the shared rows, which are averaged in the order of the threads,
+     * so that the result does not depend on the timing of the threads. Copies are stored in blocks
+     * that are never moved, so pointers to them remain valid until the replica is cleared.
+    */
+    class replica_t final {
+    private:
+        static const std::size_t blockSize = 1024; ///< copies in a block
+
+        matrix_t *m_matrix;
+        std::vector<uint32_t> m_slots; ///< positions of the copies + 1, or 0 if not copied
+        std::vector<uint32_t> m_rows; ///< rows copied in the current round
+        std::vector<matrix_t> m_blocks;
+
+        inline float *copy(std::size_t _s) noexcept {
+            return m_blocks[_s / blockSize].row(_s % blockSize);
+        }
+
+    public:
+        explicit replica_t(matrix_t &_matrix): m_matrix(&_matrix), m_slots(_matrix.nrow(), 0) {}
+
+        /// @returns copy of the i-th row, made from the shared row when it is used first
+        inline float *row(std::size_t _i) {
+            uint32_t s = m_slots[_i];
+            if (s == 0) {
+                s = m_rows.size();
+                if (s == m_blocks.size() * blockSize)
+                    m_blocks.push_back(matrix_t(blockSize, m_matrix->ncol()));
+                std::memcpy(copy(s), m_matrix->row(_i), m_matrix->stride() * sizeof(float));
+                m_rows.push_back(_i);
+                m_slots[_i] = ++s;
+            }
+            return copy(s - 1);
+        }
+
+        /// Changes the copies to their differences from the shared rows
+        void diff() noexcept {
+            std::size_t K = m_matrix->stride();
+            for (std::size_t s = 0; s < m_rows.size(); ++s) {
+                float *delta = copy(s);
+                const float *shared = m_matrix->row(m_rows[s]);
+                for (std::size_t k = 0; k < K; ++k)
+                    delta[k] -= shared[k];
+            }
+        }
+
+        /**
+         * Adds the average differences of the rows in the replicas to the shared matrix
+         * 
+         * Differences of a row are summed in the order of the replicas and divided by the number of
+         * the replicas in which the row is copied, so that frequently used rows are not moved by 
+         * all the threads in the same direction.
+         * @param _replicas replicas of the same matrix after diff()
+         * @param _part rows whose indices modulo _parts are equal to _part are updated
+         * @param _parts number of the threads that update the rows in parallel
+        */
+        static void merge(std::vector<replica_t> &_replicas,
+                          std::size_t _part, std::size_t _parts) noexcept {
+            for (std::size_t r = 0; r < _replicas.size(); ++r) {
+                replica_t &replica = _replicas[r];
+                matrix_t &matrix = *replica.m_matrix;
+                std::size_t K = matrix.stride();
+                for (std::size_t s = 0; s < replica.m_rows.size(); ++s) {
+                    std::size_t i = replica.m_rows[s];
+                    if (i % _parts != _part)
+                        continue;
+                    // rows are merged when they are found in the first replica
+                    bool merged = false;
+                    for (std::size_t q = 0; q < r && !merged; ++q)
+                        merged = _replicas[q].m_slots[i] != 0;
+                    if (merged)
+                        continue;
+                    float *shared = matrix.row(i);
+                    float *sum = replica.copy(s);
+                    std::size_t n = 1;
+                    for (std::size_t q = r + 1; q < _replicas.size(); ++q) {
+                        uint32_t t = _replicas[q].m_slots[i];
+                        if (t == 0)
+                            continue;
+                        const float *delta = _replicas[q].copy(t - 1);
+                        for (std::size_t k = 0; k < K; ++k)
+                            sum[k] += delta[k];
+                        n++;
+                    }
+                    float scale = 1.0f / n;
+                    for (std::size_t k = 0; k < K; ++k)
+                        shared[k] += sum[k] * scale;
+                }
+            }
+        }
+
+        /// Discards the copies but keeps the blocks for the next round
+        void clear() noexcept {
+            for (auto i : m_rows)
+                m_slots[i] = 0;
+            m_rows.clear();
+        }
+    };
+}
+
+#endif // WORD2VEC_REPLICA_H
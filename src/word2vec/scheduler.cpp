@@ -0,0 +1,123 @@
+/**
+ * @file
+ * @brief scheduler distributes chunks of documents to train threads
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "scheduler.hpp"
+
+namespace w2v {
+    scheduler_t::scheduler_t(const corpus_t &_corpus, std::size_t _threads, std::size_t _chunksPerThread,
+                             bool _steal):
+        m_queues(_threads), m_steal(_steal) {
+        
+        if (_threads == 0)
+            throw std::runtime_error("number of threads is zero");
+        
+        // documents are weighted by the words counted in them
+        std::size_t n = _corpus.size();
+        if (_corpus.docWords.size() != n)
+            throw std::runtime_error("words in documents are not counted");
+        const std::vector<unsigned int> &words = _corpus.docWords;
+        std::size_t total = 0;
+        for (std::size_t h = 0; h < n; ++h)
+            total += words[h];
+        std::size_t target = std::max(total / (_threads * std::max<std::size_t>(_chunksPerThread, 1)),
+                                      static_cast<std::size_t>(1));
+        
+        // cut chunks when they reach the target size; long documents form chunks by themselves
+        std::size_t size = 0;
+        m_bounds.push_back(0);
+        for (std::size_t h = 0; h < n; ++h) {
+            size += words[h];
+            if (size >= target) {
+                m_bounds.push_back(h + 1);
+                size = 0;
+            }
+        }
+        if (m_bounds.back() != n)
+            m_bounds.push_back(n);
+        if (chunks() > UINT32_MAX)
+            throw std::runtime_error("too many chunks of documents");
+        fill();
+    }
+    
+    void scheduler_t::fill() noexcept {
+        std::size_t c = chunks();
+        std::size_t t = m_queues.size();
+        for (std::size_t i = 0; i < t; ++i) {
+            uint64_t first = c * i / t;
+            uint64_t last = c * (i + 1) / t;
+            m_queues[i].range.store((first << 32) | last, std::memory_order_relaxed);
+        }
+    }
+    
+    bool scheduler_t::next(std::size_t _id, std::pair<std::size_t, std::size_t> &_range, 
+                           std::size_t &_chunk, bool &_stolen) noexcept {
+        
+        if (m_cancelled.load(std::memory_order_relaxed))
+            return false;
+        std::size_t t = m_queues.size();
+        for (std::size_t j = 0; j < (m_steal ? t : 1); ++j) {
+            std::size_t i = (_id + j) % t;
+            bool own = j == 0;
+            auto &range = m_queues[i].range;
+            uint64_t r = range.load(std::memory_order_relaxed);
+            while (true) {
+                uint64_t first = r >> 32;
+                uint64_t last = r & UINT32_MAX;
+                if (first >= last)
+                    break;
+                // the owner takes the first and the others take the last chunk
+                uint64_t c = own ? first : last - 1;
+                uint64_t s = own ? ((first + 1) << 32) | last : (first << 32) | (last - 1);
+                if (range.compare_exchange_weak(r, s, std::memory_order_relaxed)) {
+                    _range = std::make_pair(m_bounds[c], m_bounds[c + 1]);
+                    _chunk = c;
+                    _stolen = !own;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+    
+    bool scheduler_t::wait() noexcept {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::size_t epoch = m_epoch;
+        if (++m_waiting == m_queues.size()) {
+            // all the queues are empty and no thread is taking chunks
+            fill();
+            m_waiting = 0;
+            m_epoch++;
+            m_stopped = m_cancelled; // all the threads see the same value
+            m_cv.notify_all();
+        } else {
+            m_cv.wait(lock, [&] {return m_epoch != epoch;});
+        }
+        return !m_stopped;
+    }
+    
+    void scheduler_t::sync() noexcept {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::size_t round = m_round;
+        if (++m_synced == m_queues.size()) {
+            m_synced = 0;
+            m_round++;
+            m_cv.notify_all();
+        } else {
+            m_cv.wait(lock, [&] {return m_round != round;});
+        }
+    }
+    
+    std::size_t scheduler_t::waitFor(std::size_t _epoch, std::chrono::milliseconds _timeout) noexcept {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait_for(lock, _timeout, [&] {return m_epoch != _epoch;});
+        return m_epoch;
+    }
+}
@@ -0,0 +1,115 @@
+/**
+ * @file
+ * @brief scheduler distributes chunks of documents to train threads
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#ifndef WORD2VEC_SCHEDULER_H
+#define WORD2VEC_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "word2vec.hpp"
+
+namespace w2v {
+    /**
+     * @brief scheduler class - token-balanced chunks of documents with work stealing
+     *
+     * Documents are grouped into contiguous chunks of about the same number of tokens and the chunks 
+     * are divided equally between the threads. A thread takes chunks from the front of its own queue 
+     * and, when the queue is empty, steals chunks from the back of the other threads' queues. Each 
+     * queue is a pair of indices packed in a 64-bit atomic, so neither operation takes a lock. Threads 
+     * wait for each other at the end of an epoch before the queues are refilled; the main thread can
+     * wait for the end of epochs on the same condition variable to report the progress.
+     * 
+     * In deterministic training, threads do not steal chunks but take the same chunks of their own
+     * queues in every epoch, and wait for each other at the end of rounds in which they train models
+     * on one chunk each.
+    */
+    class scheduler_t final {
+    private:
+        struct alignas(64) queue_t final {
+            std::atomic<uint64_t> range{0}; ///< first chunk in the upper and last chunk + 1 in the lower 32 bits
+        };
+        
+        std::vector<std::size_t> m_bounds; ///< first document of the chunks followed by the number of documents
+        std::vector<queue_t> m_queues;
+        bool m_steal;
+        // barrier at the end of an epoch
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::size_t m_waiting = 0;
+        std::size_t m_epoch = 0;
+        // barrier in an epoch
+        std::size_t m_synced = 0;
+        std::size_t m_round = 0;
+        std::atomic<bool> m_cancelled{false};
+        bool m_stopped = false; ///< cancelled when the last epoch ended
+
+    public:
+        /**
+         * Constructs chunks of documents
+         * @param _corpus documents to train models
+         * @param _threads number of train threads
+         * @param _chunksPerThread number of chunks in the queue of each thread
+         * @param _steal allow threads to take chunks from other threads' queues
+        */
+        scheduler_t(const corpus_t &_corpus, std::size_t _threads, std::size_t _chunksPerThread = 16,
+                    bool _steal = true);
+        
+        // copying prohibited
+        scheduler_t(const scheduler_t &) = delete;
+        void operator=(const scheduler_t &) = delete;
+        
+        /**
+         * Takes the next chunk for a thread
+         * @param _id thread ID, starting from 0
+         * @param[out] _range first and last + 1 documents of the chunk
+         * @param[out] _chunk index of the chunk
+         * @param[out] _stolen true if the chunk was taken from another thread's queue
+         * @returns false if no chunk is left in the current epoch
+        */
+        bool next(std::size_t _id, std::pair<std::size_t, std::size_t> &_range, std::size_t &_chunk,
+                  bool &_stolen) noexcept;
+        
+        /**
+         * Blocks until all the threads finish the current epoch, and refills the queues
+         * @returns false if the training is cancelled
+        */
+        bool wait() noexcept;
+        
+        /// Blocks until all the threads call this function
+        void sync() noexcept;
+        
+        /**
+         * Blocks until an epoch ends or the time passes
+         * @param _epoch number of epochs ended before
+         * @param _timeout maximum time to wait
+         * @returns number of epochs ended
+        */
+        std::size_t waitFor(std::size_t _epoch, std::chrono::milliseconds _timeout) noexcept;
+        
+        /// Stops giving chunks to the threads
+        void cancel() noexcept {m_cancelled = true;}
+        
+        /// @returns number of chunks
+        std::size_t chunks() const noexcept {return m_bounds.size() - 1;}
+        /// @returns maximum number of chunks in the queue of a thread
+        std::size_t rounds() const noexcept {return (chunks() + threads() - 1) / threads();}
+        /// @returns number of threads
+        std::size_t threads() const noexcept {return m_queues.size();}
+        
+    private:
+        void fill() noexcept;
+    };
+}
+
+#endif // WORD2VEC_SCHEDULER_H
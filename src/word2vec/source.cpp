@@ -0,0 +1,263 @@
+/**
+ * @file
+ * @brief sources of documents in memory or in files
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+#include "source.hpp"
+#include "vbyte.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(unsigned int) == 4, "tokens must be 32-bit integers");
+
+namespace w2v {
+    namespace {
+        const char magic[8] = {'W', '2', 'V', 'T', 'O', 'K', 'S', '2'};
+
+        // magic, number of documents, bytes of the tokens and number of types
+        const std::size_t headerSize = sizeof(magic) + 3 * sizeof(uint64_t);
+
+        std::size_t pageSize() {
+#if defined(_WIN32)
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwPageSize;
+#else
+            return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        }
+    }
+
+    fileSource_t::fileSource_t(const std::string &_file) {
+
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(_file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("failed to open " + _file);
+        m_file = file;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            unmap();
+            throw std::runtime_error("failed to read " + _file);
+        }
+        m_bytes = static_cast<std::size_t>(size.QuadPart);
+        if (m_bytes >= headerSize) {
+            m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mapping)
+                m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+#else
+        int fd = open(_file.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("failed to open " + _file);
+        struct stat st;
+        if (fstat(fd, &st) == 0)
+            m_bytes = static_cast<std::size_t>(st.st_size);
+        if (m_bytes >= headerSize) {
+            void *ptr = mmap(nullptr, m_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED)
+                m_data = ptr;
+        }
+        close(fd); // the mapping remains valid
+#endif
+        if (!m_data) {
+            unmap();
+            throw std::runtime_error("failed to read " + _file);
+        }
+
+        // validate the structure before the documents are read by the threads
+        try {
+            const char *data = static_cast<const char*>(m_data);
+            if (std::memcmp(data, magic, sizeof(magic)) != 0)
+                throw std::runtime_error("invalid token file");
+            uint64_t header[3];
+            std::memcpy(header, data + sizeof(magic), sizeof(header));
+            m_size = header[0];
+            std::size_t nbyte = header[1];
+            std::size_t ntype = header[2];
+            if (m_size >= m_bytes || nbyte >= m_bytes || ntype >= m_bytes)
+                throw std::runtime_error("invalid token file");
+            std::size_t bytes = headerSize + (m_size + 1) * sizeof(uint64_t) + nbyte + vbyte::padding;
+            if (bytes > m_bytes)
+                throw std::runtime_error("invalid token file");
+            m_offsets = reinterpret_cast<const uint64_t*>(data + headerSize);
+            m_stream = reinterpret_cast<const uint8_t*>(m_offsets + m_size + 1);
+            // documents are checked when they are read, not to read the whole file here
+            if (m_offsets[0] != 0 || m_offsets[m_size] != nbyte)
+                throw std::runtime_error("invalid token file");
+
+            // types with their lengths
+            const char *p = data + bytes;
+            const char *end = data + m_bytes;
+            m_types.reserve(ntype);
+            for (std::size_t i = 0; i < ntype; ++i) {
+                uint32_t len;
+                if (end - p < (std::ptrdiff_t)sizeof(len))
+                    throw std::runtime_error("invalid token file");
+                std::memcpy(&len, p, sizeof(len));
+                p += sizeof(len);
+                if (end - p < (std::ptrdiff_t)len)
+                    throw std::runtime_error("invalid token file");
+                m_types.emplace_back(p, len);
+                p += len;
+            }
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    fileSource_t::~fileSource_t() {
+        unmap();
+    }
+
+    void fileSource_t::unmap() noexcept {
+#if defined(_WIN32)
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file)
+            CloseHandle(m_file);
+        m_mapping = m_file = nullptr;
+#else
+        if (m_data)
+            munmap(m_data, m_bytes);
+#endif
+        m_data = nullptr;
+    }
+
+    const uint8_t *fileSource_t::header(std::size_t _h, uint64_t &_length) const noexcept {
+        _length = 0;
+        uint64_t first = m_offsets[_h];
+        uint64_t last = m_offsets[_h + 1];
+        if (first > last || last > m_offsets[m_size])
+            return nullptr;
+        const uint8_t *end = m_stream + last;
+        const uint8_t *p = vbyte::decodeVarint(m_stream + first, end, _length);
+        // lengths are checked before the bytes of the tokens are computed from them
+        if (!p || _length > UINT32_MAX || _length > 4 * (uint64_t)(end - p)) {
+            _length = 0;
+            return nullptr;
+        }
+        return p;
+    }
+
+    std::size_t fileSource_t::length(std::size_t _h) const noexcept {
+        uint64_t len = 0;
+        header(_h, len);
+        return len;
+    }
+
+    textView_t fileSource_t::text(std::size_t _h, text_t &_buffer) const {
+        uint64_t len = 0;
+        const uint8_t *p = header(_h, len);
+        // documents must be decoded without reading past their ends
+        if (!p || vbyte::size(p, len) != (std::size_t)(m_stream + m_offsets[_h + 1] - p))
+            throw std::runtime_error("invalid token file");
+        if (_buffer.size() < len)
+            _buffer.resize(len);
+        vbyte::decode(p, len, _buffer.data());
+        return textView_t(_buffer.data(), len);
+    }
+
+    void fileSource_t::advise(std::size_t _first, std::size_t _last, bool _need) const noexcept {
+
+        if (_first >= _last || _last > m_size)
+            return;
+        static const std::size_t page = pageSize();
+        const char *base = static_cast<const char*>(m_data);
+        // offsets are not checked until the documents are read
+        uint64_t nbyte = m_offsets[m_size];
+        std::size_t from = reinterpret_cast<const char*>(m_stream + std::min(m_offsets[_first], nbyte)) - base;
+        std::size_t to = reinterpret_cast<const char*>(m_stream + std::min(m_offsets[_last], nbyte)) - base;
+        // pages shared with adjacent documents are kept for other threads
+        if (_need) {
+            from = from / page * page;
+        } else {
+            from = (from + page - 1) / page * page;
+            to = to / page * page;
+        }
+        if (from >= to)
+            return;
+#if !defined(_WIN32) // pages are managed only by the system on Windows
+        posix_madvise(const_cast<char*>(base + from), to - from,
+                      _need ? POSIX_MADV_WILLNEED : POSIX_MADV_DONTNEED);
+#endif
+    }
+
+    void fileSource_t::write(const std::string &_file, const source_t &_source, const types_t &_types) {
+
+        std::ofstream out(_file, std::ios::binary);
+        if (!out)
+            throw std::runtime_error("failed to open " + _file);
+
+        // frequent types get small IDs
+        text_t buffer;
+        std::vector<std::size_t> frequency(_types.size() + 1, 0);
+        for (std::size_t h = 0; h < _source.size(); ++h) {
+            for (auto word : _source.text(h, buffer)) {
+                if (word > _types.size())
+                    throw std::range_error("invalid token object");
+                frequency[word]++;
+            }
+        }
+        std::vector<unsigned int> order(_types.size());
+        std::iota(order.begin(), order.end(), 1);
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int _a, unsigned int _b) {
+            return frequency[_a] > frequency[_b];
+        });
+        std::vector<unsigned int> ids(_types.size() + 1, 0); // padding remains 0
+        for (std::size_t i = 0; i < order.size(); ++i)
+            ids[order[i]] = i + 1;
+
+        // the header and the offsets are written after the documents
+        std::vector<uint64_t> offsets(_source.size() + 1, 0);
+        out.write(magic, sizeof(magic));
+        out.seekp(headerSize + offsets.size() * sizeof(uint64_t));
+        std::vector<uint8_t> bytes;
+        for (std::size_t h = 0; h < _source.size(); ++h) {
+            textView_t text = _source.text(h, buffer);
+            text_t tokens(text.size());
+            for (std::size_t i = 0; i < text.size(); ++i)
+                tokens[i] = ids[text[i]];
+            bytes.clear();
+            vbyte::encodeVarint(tokens.size(), bytes);
+            vbyte::encode(tokens.data(), tokens.size(), bytes);
+            out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            offsets[h + 1] = offsets[h] + bytes.size();
+        }
+        const char padding[vbyte::padding] = {};
+        out.write(padding, sizeof(padding));
+        for (auto i : order) {
+            const std::string &type = _types[i - 1];
+            uint32_t len = type.size();
+            out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+            out.write(type.data(), len);
+        }
+
+        uint64_t header[3] = {_source.size(), offsets.back(), _types.size()};
+        out.seekp(sizeof(magic));
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        if (!out)
+            throw std::runtime_error("failed to write " + _file);
+    }
+}
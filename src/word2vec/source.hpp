@@ -0,0 +1,148 @@
+/**
+ * @file
+ * @brief sources of documents in memory or in files
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#ifndef WORD2VEC_SOURCE_H
+#define WORD2VEC_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+typedef std::vector<std::string> types_t;
+typedef std::vector<unsigned int> text_t;
+typedef std::vector<text_t> texts_t;
+typedef std::vector<size_t> frequency_t;
+
+namespace w2v {
+
+    /**
+     * @brief read-only view of the tokens in a document
+     */
+    class textView_t final {
+    private:
+        const unsigned int *m_data = nullptr;
+        std::size_t m_size = 0;
+
+    public:
+        textView_t() = default;
+        textView_t(const unsigned int *_data, std::size_t _size): m_data(_data), m_size(_size) {}
+        textView_t(const text_t &_text): m_data(_text.data()), m_size(_text.size()) {}
+
+        std::size_t size() const noexcept {return m_size;}
+        const unsigned int *begin() const noexcept {return m_data;}
+        const unsigned int *end() const noexcept {return m_data + m_size;}
+        const unsigned int &operator[](std::size_t _i) const noexcept {return m_data[_i];}
+    };
+
+    /**
+     * @brief source class - documents of tokens read by the train threads
+     *
+     * Tokens are IDs of types starting from 1; 0 is padding. Sources may hold only parts of the
+     * documents in memory, so readers tell them the ranges of documents they need next and no longer
+     * need.
+     */
+    class source_t {
+    public:
+        virtual ~source_t() = default;
+
+        /// @returns number of documents
+        virtual std::size_t size() const noexcept = 0;
+        /// @returns number of tokens in the h-th document
+        virtual std::size_t length(std::size_t _h) const noexcept = 0;
+        /**
+         * Reads a document
+         * @param _buffer storage of the tokens if they need to be decoded
+         * @returns tokens in the h-th document, valid until the buffer is changed
+         */
+        virtual textView_t text(std::size_t _h, text_t &_buffer) const = 0;
+        /// Hints that the documents in [first, last) will be read soon
+        virtual void prefetch(std::size_t, std::size_t) const noexcept {}
+        /// Hints that the documents in [first, last) will not be read until the next pass
+        virtual void release(std::size_t, std::size_t) const noexcept {}
+    };
+
+    /**
+     * @brief memory source class - documents in a vector owned by the caller
+     */
+    class memorySource_t final: public source_t {
+    private:
+        const texts_t &m_texts;
+
+    public:
+        explicit memorySource_t(const texts_t &_texts): m_texts(_texts) {}
+
+        std::size_t size() const noexcept override {return m_texts.size();}
+        std::size_t length(std::size_t _h) const noexcept override {return m_texts[_h].size();}
+        textView_t text(std::size_t _h, text_t &) const override {return textView_t(m_texts[_h]);}
+    };
+
+    /**
+     * @brief file source class - documents in a binary file mapped to memory
+     *
+     * The file contains a header, the offsets of the documents and a stream of their tokens,
+     * followed by the types. Each document is the number of tokens in LEB128 and the token IDs in
+     * stream VByte, which are decoded by the readers into their buffers. The types are sorted by
+     * frequency in the file, so that most of the IDs are stored in one or two bytes. Pages of the
+     * file are read by the kernel on demand and released after use, so corpora larger than the
+     * memory can be processed.
+     */
+    class fileSource_t final: public source_t {
+    private:
+        void *m_data = nullptr;
+        std::size_t m_bytes = 0;
+#if defined(_WIN32)
+        void *m_file = nullptr;
+        void *m_mapping = nullptr;
+#endif
+        std::size_t m_size = 0;
+        const uint64_t *m_offsets = nullptr;
+        const uint8_t *m_stream = nullptr;
+        types_t m_types;
+
+        // @returns number of tokens and pointer to their IDs, or nullptr if they are invalid
+        const uint8_t *header(std::size_t _h, uint64_t &_length) const noexcept;
+
+        void advise(std::size_t _first, std::size_t _last, bool _need) const noexcept;
+        void unmap() noexcept;
+
+    public:
+        /**
+         * Maps a file written by write()
+         * @throws std::runtime_error if the file cannot be read or is invalid
+         */
+        explicit fileSource_t(const std::string &_file);
+        ~fileSource_t() override;
+
+        // copying prohibited
+        fileSource_t(const fileSource_t &) = delete;
+        void operator=(const fileSource_t &) = delete;
+
+        std::size_t size() const noexcept override {return m_size;}
+        std::size_t length(std::size_t _h) const noexcept override;
+        /// @throws std::runtime_error if the document is invalid
+        textView_t text(std::size_t _h, text_t &_buffer) const override;
+        void prefetch(std::size_t _first, std::size_t _last) const noexcept override {
+            advise(_first, _last, true);
+        }
+        void release(std::size_t _first, std::size_t _last) const noexcept override {
+            advise(_first, _last, false);
+        }
+
+        /// @returns types in the file
+        const types_t &types() const noexcept {return m_types;}
+
+        /**
+         * Writes documents to a file
+         * @throws std::runtime_error if the file cannot be written
+         */
+        static void write(const std::string &_file, const source_t &_source, const types_t &_types);
+    };
+}
+
+#endif // WORD2VEC_SOURCE_H
@@ -10,342 +10,441 @@
 
 namespace w2v {
     
-    trainThread_t::trainThread_t(const std::pair<std::size_t, std::size_t> &_range, 
-                                 const data_t &_data) :
-            m_range(_range),
-            m_data(_data), m_randomGenerator(m_data.settings->random),
-            //m_rndWindowShift(0, static_cast<short>((m_data.settings->window - 1))), // NOTE: to delete
-            m_rndWindow(1, static_cast<short>((m_data.settings->window))), // NOTE: added
-            m_downSampling(), m_nsDistribution(), m_hiddenLayerValues(), m_hiddenLayerErrors(),
-            m_thread() {
+    trainThread_t::trainThread_t(std::size_t _id, const data_t &_data) :
+            m_id(_id),
+            m_data(_data), m_alpha(m_data.settings->alpha), m_random(m_data.settings->random, _id),
+            m_kernels(kernels(matrix_t::stride(m_data.settings->size))), m_thread() {
 
         if (!m_data.settings) {
             throw std::runtime_error("train settings are not initialized");
         }
 
-        if (m_data.settings->sample < 1.0f) {
-            m_downSampling.reset(new downSampling_t(m_data.settings->sample,
-                                                    m_data.corpus->trainWords));
+        if (m_data.settings->sample < 1.0f && !m_data.downSampling) {
+            throw std::runtime_error("down-sampling thresholds are not initialized");
         }
 
-        if (m_data.settings->negative > 0) {
-            m_nsDistribution.reset(new nsDistribution_t(m_data.corpus->frequency));
+        if (m_data.settings->negative > 0 && !m_data.nsDistribution) {
+            throw std::runtime_error("negative sampling distribution is not initialized");
         }
 
         if (m_data.settings->withHS && !m_data.huffmanTree) {
             throw std::runtime_error("Huffman tree object is not initialized");
         }
 
-        m_hiddenLayerErrors.reset(new std::vector<float>(m_data.settings->size));
-        m_hiddenLayerValues.reset(new std::vector<float>(m_data.settings->size)); // not used in SG
-        m_docLayerErrors.reset(new std::vector<float>(m_data.settings->size));
-        m_docLayerValues.reset(new std::vector<float>(m_data.settings->size)); // not used in SG
+        if (m_data.pjReplicas && m_data.bpReplicas) {
+            if (m_data.pjReplicas->size() <= m_id || m_data.bpReplicas->size() <= m_id)
+                throw std::runtime_error("replicas of matrices are not initialized");
+            m_pjReplica = &(*m_data.pjReplicas)[m_id];
+            m_bpReplica = &(*m_data.bpReplicas)[m_id];
+        }
+
+        m_hiddenLayer = matrix_t(2, m_data.settings->size);
+        m_hiddenLayerValues = m_hiddenLayer.row(0); // not used in SG and DBOW
+        m_hiddenLayerErrors = m_hiddenLayer.row(1);
+        m_tokens.reserve(m_data.corpus->maxLength);
+        m_sentence.reserve(m_data.corpus->maxLength);
+        if (m_data.settings->batch) {
+            std::size_t contexts = 2 * static_cast<std::size_t>(m_data.settings->window);
+            std::size_t targets = static_cast<std::size_t>(m_data.settings->negative) + 1;
+            m_batchErrors = matrix_t(contexts, m_data.settings->size);
+            m_batchGradients.resize(contexts * targets);
+            m_batchTargets.resize(targets);
+        }
         
         if (!m_data.corpus) {
             throw std::runtime_error("corpus object is not initialized");
         }
         
+        if (!m_data.progress || m_data.progress->size() <= m_id) {
+            throw std::runtime_error("progress counters are not initialized");
+        }
+        
+        if (!m_data.scheduler || m_data.scheduler->threads() <= m_id) {
+            throw std::runtime_error("scheduler is not initialized");
+        }
+        
+        // the model is selected once instead of for each document
+        static const model_t models[][2] = {
+            {&trainThread_t::cbow<false>, &trainThread_t::cbow<true>},
+            {&trainThread_t::sg<false>, &trainThread_t::sg<true>},
+            {&trainThread_t::dm<false>, &trainThread_t::dm<true>},
+            {&trainThread_t::dbow<false>, &trainThread_t::dbow<true>}
+        };
+        int type = m_data.settings->type;
+        if (type == 2 && m_data.settings->batch && !m_data.settings->withHS) {
+            m_model = &trainThread_t::sgBatch; // sg with shared negative samples
+        } else if (type >= 1 && type <= 4) {
+            m_model = models[type - 1][m_data.settings->withHS];
+        }
     }
 
-    void trainThread_t::worker(int &_iter, float &_alpha) noexcept {
+    void trainThread_t::worker() noexcept {
         
+        auto &progress = *m_data.progress;
+        scheduler_t &scheduler = *m_data.scheduler;
+        
+        std::pair<std::size_t, std::size_t> range;
+        std::size_t chunk = 0;
+        bool stolen = false;
+        auto start = std::chrono::steady_clock::now();
         for (auto g = 1; g <= m_data.settings->iterations; ++g) {
             
-            std::size_t threadProcessedWords = 0;
-            std::size_t prvThreadProcessedWords = 0;
-            
-            auto wordsPerAllThreads = m_data.settings->iterations * m_data.corpus->trainWords;
-            auto wordsPerAlpha = wordsPerAllThreads / 10000;
-            
-            float alpha = 0;
-            for (std::size_t h = m_range.first; h <= m_range.second; ++h) {
-                
-                // calculate alpha
-                if (threadProcessedWords - prvThreadProcessedWords > wordsPerAlpha) { // next 0.01% processed
-                    *m_data.processedWords += threadProcessedWords - prvThreadProcessedWords;
-                    prvThreadProcessedWords = threadProcessedWords;
-
-                    float ratio = static_cast<float>(*(m_data.processedWords)) / wordsPerAllThreads;
-                    alpha = m_data.settings->alpha * (1 - ratio);
-                    if (alpha < m_data.settings->alpha * 0.0001f) {
-                        alpha = m_data.settings->alpha * 0.0001f;
-                    }
-                    (*m_data.alpha) = alpha;
+            // random numbers depend on the chunk but not on the thread that takes it
+            std::size_t stream = (g - 1) * scheduler.chunks();
+            if (m_data.settings->deterministic) {
+                // every thread trains on a chunk in a round, even after cancellation
+                for (std::size_t r = 0; r < scheduler.rounds(); ++r) {
+                    if (scheduler.next(m_id, range, chunk, stolen))
+                        train(range, stream + chunk);
+                    merge();
                 }
-                
-                text_t text = m_data.corpus->texts[h];
-                //std::cout << "text: " <<  text.size() << "\n";
-                
-                // read sentence
-                std::vector<unsigned int> sentence;
+            } else {
+                while (scheduler.next(m_id, range, chunk, stolen)) {
+                    if (stolen)
+                        m_stolen++;
+                    train(range, stream + chunk);
+                }
+            }
+            auto end = std::chrono::steady_clock::now();
+            m_busy += std::chrono::duration<double>(end - start).count();
+            bool next = scheduler.wait(); // for other threads to finish the epoch
+            start = std::chrono::steady_clock::now();
+            m_idle += std::chrono::duration<double>(start - end).count();
+            if (!next)
+                break; // cancelled
+        }
+        progress[m_id].processedWords.store(m_processedWords, std::memory_order_relaxed);
+    }
+
+    void trainThread_t::train(std::pair<std::size_t, std::size_t> _range, std::size_t _stream) noexcept {
+        
+        auto &progress = *m_data.progress;
+        auto wordsPerAllThreads = m_data.settings->iterations * m_data.corpus->trainWords;
+        auto wordsPerAlpha = wordsPerAllThreads / 10000;
+        
+        m_random.seed(m_data.settings->random, _stream);
+        m_data.corpus->source().prefetch(_range.first, _range.second);
+        for (std::size_t h = _range.first; h < _range.second; ++h) {
+        
+            // calculate alpha
+            if (m_data.settings->deterministic) {
+                // words processed by the other threads in the round are estimated from this thread
+                std::size_t processedWords = m_roundWords + 
+                    (m_processedWords - m_roundStart) * m_data.scheduler->threads();
+                m_alpha = learningRate(*m_data.settings, processedWords, wordsPerAllThreads);
+            } else if (m_processedWords - m_prvProcessedWords > wordsPerAlpha) { // next 0.01% processed
+                progress[m_id].processedWords.store(m_processedWords, std::memory_order_relaxed);
+                m_prvProcessedWords = m_processedWords;
+            
+                // snapshot of all the threads
+                std::size_t processedWords = 0;
+                for (auto &p : progress)
+                    processedWords += p.processedWords.load(std::memory_order_relaxed);
+                m_alpha = learningRate(*m_data.settings, processedWords, wordsPerAllThreads);
+            }
+        
+            textView_t text = m_data.corpus->text(h, m_tokens);
+            //std::cout << "text: " <<  text.size() << "\n";
+        
+            // read sentence into the buffer reused across documents
+            std::vector<unsigned int> &sentence = m_sentence;
+            if (sentence.capacity() < text.size()) {
                 sentence.reserve(text.size());
-                for (size_t i = 0; i < text.size(); ++i) {
+                m_allocations++;
+            }
+            sentence.clear();
+            for (size_t i = 0; i < text.size(); ++i) {
 
-                    auto &word = text[i];
-                    // ignore padding
-                    if (word == 0) { 
-                        //std::cout << "padding: " << word << "\n";
-                        continue; 
-                    }
+                auto word = m_data.corpus->id(text[i]);
+                // ignore padding and removed words
+                if (word == 0) { 
+                    //std::cout << "padding: " << word << "\n";
+                    continue; 
+                }
 
-                    threadProcessedWords++;
-                    if (m_data.settings->sample < 1.0f) {
-                        if ((*m_downSampling)(m_data.corpus->frequency[word - 1], m_randomGenerator)) {
-                            //std::cout << "downsample: " << word << "\n";
-                            continue; // skip this word
-                        }
+                m_processedWords++;
+                if (m_data.settings->sample < 1.0f) {
+                    if ((*m_data.downSampling)(word - 1, m_random)) {
+                        //std::cout << "downsample: " << word << "\n";
+                        continue; // skip this word
                     }
-                    sentence.push_back(word - 1); // zero-based index of words
-                }
-                
-                if (m_data.settings->type == 1) {
-                    cbow(sentence, false);     // cbow
-                } else if (m_data.settings->type == 2) {
-                    sg(sentence, false); // sg
-                } else if (m_data.settings->type == 3) {
-                    dm(sentence, h, false);      // dm
-                } else if (m_data.settings->type == 4) {
-                    dbow(sentence, h, false); // dbow
                 }
+                sentence.push_back(word - 1); // zero-based index of words
             }
-            // for progress message
-            if (m_range.first == 0) {
-                _iter = g;
-                _alpha = alpha;
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        
+            if (m_model)
+                (this->*m_model)(sentence, h, false);
         }
-        // std::cout << "trainThread_t::worker()\n";
-        // std::cout << m_data.bpWeights << "\n";
-        // for (size_t i = 0; i < 10; i++){
-        //     std::cout << (*m_data.bpWeights)[i] << ", ";
-        // }
-        // std::cout << "\n";
+        m_data.corpus->source().release(_range.first, _range.second);
     }
 
+    void trainThread_t::merge() noexcept {
+        
+        auto &progress = *m_data.progress;
+        progress[m_id].processedWords.store(m_processedWords, std::memory_order_relaxed);
+        if (m_pjReplica) {
+            m_pjReplica->diff();
+            m_bpReplica->diff();
+        }
+        m_data.scheduler->sync(); // for other threads to finish the round
+        
+        // the matrices and the counters are not changed by other threads until the next round
+        m_roundWords = 0;
+        for (auto &p : progress)
+            m_roundWords += p.processedWords.load(std::memory_order_relaxed);
+        m_roundStart = m_processedWords;
+        if (m_pjReplica) {
+            std::size_t threads = m_data.scheduler->threads();
+            replica_t::merge(*m_data.pjReplicas, m_id, threads);
+            replica_t::merge(*m_data.bpReplicas, m_id, threads);
+        }
+        m_data.scheduler->sync(); // for other threads to finish merging
+        if (m_pjReplica) {
+            m_pjReplica->clear();
+            m_bpReplica->clear();
+        }
+    }
+
+    template <bool HS>
     inline void trainThread_t::cbow(const std::vector<unsigned int> &_text,
+                                    std::size_t, 
                                     bool freeze) noexcept {
         
-        std::size_t K = m_data.settings->size;
+        std::size_t K = m_data.pjLayerValues->stride(); // including padding
         if (_text.size() == 0)
             return;
         for (std::size_t i = 0; i < _text.size(); ++i) {
-            // hidden layers initialized with 0 values for each target word
-            std::memset(m_hiddenLayerValues->data(), 0, m_hiddenLayerValues->size() * sizeof(float));
-            std::memset(m_hiddenLayerErrors->data(), 0, m_hiddenLayerErrors->size() * sizeof(float));
-
-            int window = m_rndWindow(m_randomGenerator);
+            int window = 1 + m_random.bounded(m_data.settings->window);
             std::size_t from = std::max(0, (int)i - window);
             std::size_t to = std::min((int)_text.size(), (int)i + window);
-            std::size_t cw = 0;
+            std::size_t cw = to - from - 1; // context words excluding the target word
+            if (cw == 0)
+                continue;
+            
+            // hidden layer initialized with the first context word
+            float scale = 1.0f / cw;
+            bool first = true;
             for (std::size_t j = from; j < to; ++j) {
                 if (j == i)
                     continue;
-                auto shift = _text[j] * K;
-                for (std::size_t k = 0; k < K; ++k) {
-                    (*m_hiddenLayerValues)[k] += (*m_data.pjLayerValues)[k + shift];
+                if (first) {
+                    m_kernels.scale(scale, pjRow(_text[j]), m_hiddenLayerValues, K);
+                    first = false;
+                } else {
+                    m_kernels.axpy(scale, pjRow(_text[j]), m_hiddenLayerValues, K);
                 }
-                cw++;
-            }
-            
-            if (cw == 0)
-                continue;
-            for (std::size_t k = 0; k < K; ++k) {
-                (*m_hiddenLayerValues)[k] /= cw;
             }
             
-            if (m_data.settings->withHS) {
-                hierarchicalSoftmax(_text[i], *m_hiddenLayerErrors, *m_hiddenLayerValues, 0, freeze);
-            } else {
-                negativeSampling(_text[i], *m_hiddenLayerErrors, *m_hiddenLayerValues, 0, freeze);
-            }
+            loss<HS>(_text[i], m_hiddenLayerErrors, m_hiddenLayerValues, freeze);
             
             // hidden -> in
             for (std::size_t j = from; j < to; ++j) {
                 if (j == i)
                     continue;
-                auto shift = _text[j] * K;
-                for (std::size_t k = 0; k < K; ++k) {
-                    (*m_data.pjLayerValues)[k + shift] += (*m_hiddenLayerErrors)[k];
-                }
+                m_kernels.axpy(1.0f, m_hiddenLayerErrors, pjRow(_text[j]), K);
             }
         }
     }
 
+    template <bool HS>
     inline void trainThread_t::dm(const std::vector<unsigned int> &_text, 
                                   std::size_t _id, 
                                   bool freeze) noexcept {
         
-        std::size_t K = m_data.settings->size;
+        std::size_t K = m_data.pjLayerValues->stride(); // including padding
         if (_text.size() == 0)
             return;
-        auto docShift = _id * K;
+        float *doc = m_data.docValues->row(_id);
         for (std::size_t i = 0; i < _text.size(); ++i) {
-            // hidden layers initialized with 0 values for each target word
-            std::memset(m_hiddenLayerValues->data(), 0, m_hiddenLayerValues->size() * sizeof(float));
-            std::memset(m_hiddenLayerErrors->data(), 0, m_hiddenLayerErrors->size() * sizeof(float));
-            
-            int window = m_rndWindow(m_randomGenerator);
+            int window = 1 + m_random.bounded(m_data.settings->window);
             std::size_t from = std::max(0, (int)i - window);
             std::size_t to = std::min((int)_text.size(), (int)i + window);
-            std::size_t cw = 0;
+            std::size_t cw = to - from; // context words and the document
+            
+            // hidden layer initialized with the document vector
+            // NOTE: the same as doc2vec package
+            float scale = 1.0f / cw;
+            m_kernels.scale(scale, doc, m_hiddenLayerValues, K);
             for (std::size_t j = from; j < to; ++j) {
                 if (j == i)
                     continue;
-                auto shift = _text[j] * K;
-                for (std::size_t k = 0; k < K; ++k)
-                    (*m_hiddenLayerValues)[k] += (*m_data.pjLayerValues)[k + shift];
-                cw++;
-                
+                m_kernels.axpy(scale, pjRow(_text[j]), m_hiddenLayerValues, K);
             }
-            // NOTE: the same as doc2vec package
-            for (std::size_t k = 0; k < K; ++k)
-                (*m_hiddenLayerValues)[k] += (*m_data.docValues)[k + docShift];
-            cw++;
-            
-            
-            if (cw == 0)
-                continue;
-            for (std::size_t k = 0; k < K; ++k)
-                (*m_hiddenLayerValues)[k] /= cw;
             
             // treat word and document equally
             //   for (std::size_t k = 0; k < K; ++k)
             //       (*m_hiddenLayerValues)[k] = (*m_hiddenLayerValues)[k] / 2 +
             //                                   (*m_data.docValues)[k + docShift] / 2;
             
-            if (m_data.settings->withHS) {
-                hierarchicalSoftmax(_text[i], *m_hiddenLayerErrors, *m_hiddenLayerValues, 0, freeze);
-            } else {
-                negativeSampling(_text[i], *m_hiddenLayerErrors, *m_hiddenLayerValues, 0, freeze);
-            }
+            loss<HS>(_text[i], m_hiddenLayerErrors, m_hiddenLayerValues, freeze);
             
             // hidden -> in
             for (std::size_t j = from; j < to; ++j) {
                 if (j == i)
                     continue;
-                auto shift = _text[j] * K;
-                for (std::size_t k = 0; k < K; ++k) {
-                    (*m_data.pjLayerValues)[k + shift] += (*m_hiddenLayerErrors)[k];
-                }
-            }
-            for (std::size_t k = 0; k < K; ++k) {
-                (*m_data.docValues)[k + docShift] += (*m_hiddenLayerErrors)[k];
+                m_kernels.axpy(1.0f, m_hiddenLayerErrors, pjRow(_text[j]), K);
             }
+            m_kernels.axpy(1.0f, m_hiddenLayerErrors, doc, K);
         }
     }
 
+    template <bool HS>
     inline void trainThread_t::sg(const std::vector<unsigned int> &_text, 
+                                  std::size_t, 
                                   bool freeze) noexcept {
         
-        std::size_t K = m_data.settings->size;
+        std::size_t K = m_data.pjLayerValues->stride(); // including padding
         if (_text.size() == 0)
             return;
         for (std::size_t i = 0; i < _text.size(); ++i) {
-            int window = m_rndWindow(m_randomGenerator);
+            int window = 1 + m_random.bounded(m_data.settings->window);
             std::size_t from = std::max(0, (int)i - window);
             std::size_t to = std::min((int)_text.size(), (int)i + window);
             for (std::size_t j = from; j < to; ++j) {
                 if (j == i)
                     continue;
                 
-                // hidden layer initialized with 0 values for each context word
-                std::memset(m_hiddenLayerErrors->data(), 0, m_hiddenLayerErrors->size() * sizeof(float));
-                
-                // shift to the selected word vector in the matrix
-                auto shift = _text[j] * K;
-                if (m_data.settings->withHS) {
-                    hierarchicalSoftmax(_text[i], *m_hiddenLayerErrors, *m_data.pjLayerValues, shift, freeze);
-                } else {
-                    negativeSampling(_text[i], *m_hiddenLayerErrors, *m_data.pjLayerValues, shift, freeze);
+                // the selected word vector in the matrix
+                float *context = pjRow(_text[j]);
+                loss<HS>(_text[i], m_hiddenLayerErrors, context, freeze);
+                m_kernels.axpy(1.0f, m_hiddenLayerErrors, context, K);
+            }
+        }
+    }
+
+    inline void trainThread_t::sgBatch(const std::vector<unsigned int> &_text, 
+                                       std::size_t, 
+                                       bool freeze) noexcept {
+        
+        std::size_t K = m_data.pjLayerValues->stride(); // including padding
+        std::size_t N = static_cast<std::size_t>(m_data.settings->negative) + 1;
+        float alpha = m_alpha;
+        if (_text.size() == 0)
+            return;
+        for (std::size_t i = 0; i < _text.size(); ++i) {
+            int window = 1 + m_random.bounded(m_data.settings->window);
+            std::size_t from = std::max(0, (int)i - window);
+            std::size_t to = std::min((int)_text.size(), (int)i + window);
+            std::size_t C = to - from - 1; // context words excluding the target word
+            if (C == 0)
+                continue;
+            
+            // one set of negative samples shared by all the context words
+            m_batchTargets[0] = _text[i];
+            for (std::size_t n = 1; n < N; ++n) {
+                m_batchTargets[n] = (*m_data.nsDistribution)(m_random);
+            }
+            
+            // gradients x alpha for context words (rows) and targets (columns)
+            for (std::size_t j = from, c = 0; j < to; ++j) {
+                if (j == i)
+                    continue;
+                const float *hidden = pjRow(_text[j]);
+                for (std::size_t n = 0; n < N; ++n) {
+                    float label = n == 0 ? 1.0f : 0.0f;
+                    if (n > 0 && m_batchTargets[n] == _text[i]) {
+                        m_batchGradients[c * N + n] = 0.0f;
+                        continue;
+                    }
+                    float f = m_kernels.dot(hidden, bpRow(m_batchTargets[n]), K);
+                    m_batchGradients[c * N + n] = (label - sigmoid(f)) * alpha;
                 }
-                for (std::size_t k = 0; k < m_data.settings->size; ++k) {
-                    (*m_data.pjLayerValues)[k + shift] += (*m_hiddenLayerErrors)[k];
+                c++;
+            }
+            
+            // propagate errors output -> hidden before updating the weights
+            for (std::size_t c = 0; c < C; ++c) {
+                float *errors = m_batchErrors.row(c);
+                m_kernels.scale(m_batchGradients[c * N], bpRow(m_batchTargets[0]), errors, K);
+                for (std::size_t n = 1; n < N; ++n) {
+                    m_kernels.axpy(m_batchGradients[c * N + n], bpRow(m_batchTargets[n]), errors, K);
+                }
+            }
+            if (!freeze) {
+                // learn weights hidden -> output
+                for (std::size_t n = 0; n < N; ++n) {
+                    float *weights = bpRow(m_batchTargets[n]);
+                    for (std::size_t j = from, c = 0; j < to; ++j) {
+                        if (j == i)
+                            continue;
+                        m_kernels.axpy(m_batchGradients[c * N + n], pjRow(_text[j]), weights, K);
+                        c++;
+                    }
                 }
             }
+            // hidden -> in
+            for (std::size_t j = from, c = 0; j < to; ++j) {
+                if (j == i)
+                    continue;
+                m_kernels.axpy(1.0f, m_batchErrors.row(c), pjRow(_text[j]), K);
+                c++;
+            }
         }
     }
 
+    template <bool HS>
     inline void trainThread_t::dbow(const std::vector<unsigned int> &_text, 
                                     std::size_t _id, 
                                     bool freeze) noexcept {
         
-        std::size_t K = m_data.settings->size;
+        std::size_t K = m_data.pjLayerValues->stride(); // including padding
         if (_text.size() == 0)
             return;
-        auto docShift = _id * K;
+        float *doc = m_data.docValues->row(_id);
         for (std::size_t i = 0; i < _text.size(); ++i) {
 
-            // hidden layer initialized with 0 values for each context word
-            std::memset(m_hiddenLayerValues->data(), 0, m_hiddenLayerValues->size() * sizeof(float));
-            std::memset(m_hiddenLayerErrors->data(), 0, m_hiddenLayerErrors->size() * sizeof(float));
-            
-            for (std::size_t k = 0; k < K; ++k) {
-                (*m_hiddenLayerValues)[k] += (*m_data.docValues)[k + docShift];
-            }
+            // the document vector is the hidden layer, which is not changed until the errors are added
+            loss<HS>(_text[i], m_hiddenLayerErrors, doc, freeze);
             
-            if (m_data.settings->withHS) {
-                hierarchicalSoftmax(_text[i], *m_hiddenLayerErrors, *m_hiddenLayerValues, 0, freeze);
-            } else {
-                negativeSampling(_text[i], *m_hiddenLayerErrors, *m_hiddenLayerValues, 0, freeze);
-            }
-            
-            for (std::size_t k = 0; k < m_data.settings->size; ++k) {
-                (*m_data.docValues)[k + docShift] += (*m_hiddenLayerErrors)[k];
-            }
+            m_kernels.axpy(1.0f, m_hiddenLayerErrors, doc, K);
         }
     }
 
     inline void trainThread_t::hierarchicalSoftmax(std::size_t _word,
-                                                   std::vector<float> &_hiddenLayerErrors,
-                                                   std::vector<float> &_hiddenLayerValues,
-                                                   std::size_t _hiddenLayerShift,
+                                                   float *_hiddenLayerErrors,
+                                                   const float *_hiddenLayerValues,
                                                    bool freezeWeights) noexcept {
         
-        std::size_t K = m_data.settings->size;
+        std::size_t K = m_data.pjLayerValues->stride(); // including padding
+        const float *hidden = _hiddenLayerValues;
         auto huffmanData = m_data.huffmanTree->huffmanData(_word);
-        for (std::size_t i = 0; i < huffmanData->huffmanCode.size(); ++i) {
-            auto shift = huffmanData->huffmanPoint[i] * K;
+        if (huffmanData.length == 0)
+            std::fill(_hiddenLayerErrors, _hiddenLayerErrors + K, 0.0f);
+        for (std::size_t i = 0; i < huffmanData.length; ++i) {
+            float *weights = bpRow(huffmanData.huffmanPoint[i]);
             
             // propagate hidden -> output
-            float f = 0.0f;
-            for (std::size_t k = 0; k < K; ++k) {
-                f += _hiddenLayerValues[k + _hiddenLayerShift] * (*m_data.bpWeights)[k + shift];
-            }
-            float prob = 0;
-            if (f < -m_data.settings->expValueMax) {
-                //continue;
-                prob = 0.0f;
-            } else if (f > m_data.settings->expValueMax) {
-                //continue;
-                prob = 1.0f;
-            } else {
-                auto r = (f + m_data.settings->expValueMax) * (m_data.expTable->size() / m_data.settings->expValueMax / 2);
-                prob = (*m_data.expTable)[static_cast<std::size_t>(r)];
-            }
+            float f = m_kernels.dot(hidden, weights, K);
+            float prob = sigmoid(f);
             
             // compute gradient x alpha
-            auto gxa = (1.0f - static_cast<float>(huffmanData->huffmanCode[i]) - prob) * (*m_data.alpha);
-            // propagate errors output -> hidden
-            for (std::size_t k = 0; k < K; ++k) {
-                _hiddenLayerErrors[k] += gxa * (*m_data.bpWeights)[k + shift];
-            }
-            if (!freezeWeights) {
-                // learn weights hidden -> output
-                for (std::size_t k = 0; k < K; ++k) {
-                    (*m_data.bpWeights)[k + shift] += gxa * _hiddenLayerValues[k + _hiddenLayerShift];
+            auto gxa = (1.0f - static_cast<float>(huffmanData.huffmanCode[i]) - prob) * m_alpha;
+            // errors are initialized by the first node
+            if (freezeWeights) {
+                // propagate errors output -> hidden
+                if (i == 0) {
+                    m_kernels.scale(gxa, weights, _hiddenLayerErrors, K);
+                } else {
+                    m_kernels.axpy(gxa, weights, _hiddenLayerErrors, K);
+                }
+            } else {
+                // propagate errors output -> hidden and learn weights hidden -> output
+                if (i == 0) {
+                    m_kernels.dualScaleAxpy(gxa, hidden, weights, _hiddenLayerErrors, K);
+                } else {
+                    m_kernels.dualAxpy(gxa, hidden, weights, _hiddenLayerErrors, K);
                 }
             }
         }
     }
 
     inline void trainThread_t::negativeSampling(std::size_t _word,
-                                                std::vector<float> &_hiddenLayerErrors,
-                                                std::vector<float> &_hiddenLayerValues,
-                                                std::size_t _hiddenLayerShift,
+                                                float *_hiddenLayerErrors,
+                                                const float *_hiddenLayerValues,
                                                 bool freezeWeights) noexcept {
         
-        std::size_t K = m_data.settings->size;
+        std::size_t K = m_data.pjLayerValues->stride(); // including padding
+        const float *hidden = _hiddenLayerValues;
         for (std::size_t i = 0; i < static_cast<std::size_t>(m_data.settings->negative) + 1; ++i) {
             std::size_t target = 0;
             bool label = false;
@@ -355,41 +454,36 @@ namespace w2v {
                 label = true;
             } else {
                 // negative case
-                target = (*m_nsDistribution)(m_randomGenerator);
+                target = (*m_data.nsDistribution)(m_random);
                 if (target == _word) {
                     continue;
                 }
             }
-            auto shift = target * K;
+            float *weights = bpRow(target);
             
             // propagate hidden -> output
-            float f = 0.0f;
             // predict likelihood of _word using logistic regression
-            for (std::size_t k = 0; k < K; ++k) {
-                f += _hiddenLayerValues[k + _hiddenLayerShift] * (*m_data.bpWeights)[k + shift];
-            }
+            float f = m_kernels.dot(hidden, weights, K);
             //std::cout << f << "\n";
-            float prob = 0;
-            if (f < -m_data.settings->expValueMax) {
-                prob = 0.0f;
-            } else if (f > m_data.settings->expValueMax) {
-                prob = 1.0f;
-            } else {
-                auto r = (f + m_data.settings->expValueMax) * (m_data.expTable->size() / m_data.settings->expValueMax / 2);
-                prob = (*m_data.expTable)[static_cast<std::size_t>(r)];
-            }
+            float prob = sigmoid(f);
             
             // compute gradient x alpha
-            auto gxa = (static_cast<float>(label) - prob) * (*m_data.alpha); // gxa >= 0 in the positive case
+            auto gxa = (static_cast<float>(label) - prob) * m_alpha; // gxa >= 0 in the positive case
             //std::cout << i << ": " << _word << ", " <<  target << ", " << gxa << "\n";
-            // propagate errors output -> hidden
-            for (std::size_t k = 0; k < K; ++k) {
-                _hiddenLayerErrors[k] += gxa * (*m_data.bpWeights)[k + shift]; // added to pjLayerValues
-            }
-            if (!freezeWeights) {
-                // learn weights hidden -> output
-                for (std::size_t k = 0; k < K; ++k) {
-                    (*m_data.bpWeights)[k + shift] += gxa * _hiddenLayerValues[k + _hiddenLayerShift];
+            // errors are initialized by the positive case, which is never skipped
+            if (freezeWeights) {
+                // propagate errors output -> hidden
+                if (i == 0) {
+                    m_kernels.scale(gxa, weights, _hiddenLayerErrors, K);
+                } else {
+                    m_kernels.axpy(gxa, weights, _hiddenLayerErrors, K); // added to pjLayerValues
+                }
+            } else {
+                // propagate errors output -> hidden and learn weights hidden -> output
+                if (i == 0) {
+                    m_kernels.dualScaleAxpy(gxa, hidden, weights, _hiddenLayerErrors, K);
+                } else {
+                    m_kernels.dualAxpy(gxa, hidden, weights, _hiddenLayerErrors, K);
                 }
             }
         }
@@ -12,7 +12,9 @@
 #include <memory>
 #include <random>
 #include <thread>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <vector>
 #include <stdexcept>
@@ -21,6 +23,11 @@
 #include "huffmanTree.hpp"
 #include "nsDistribution.hpp"
 #include "downSampling.hpp"
+#include "random.hpp"
+#include "replica.hpp"
+#include "kernels.hpp"
+#include "matrix.hpp"
+#include "scheduler.hpp"
 
 namespace w2v {
     /**
@@ -34,38 +41,68 @@ namespace w2v {
     */
     class trainThread_t final {
     public:
+        /**
+         * @brief progress structure holds words processed by a train thread
+         * 
+         * Each thread writes only to its own counter, which occupies a whole cache line not to be 
+         * invalidated by the other threads.
+        */
+        struct alignas(64) progress_t final {
+            std::atomic<std::size_t> processedWords{0}; ///< words processed by the thread
+        };
+        
         /**
          * @brief data structure holds all common data used by train threads
         */
         struct data_t final {
             std::shared_ptr<settings_t> settings; ///< settings structure
-            std::shared_ptr<corpus_t> corpus; ///< train data 
-            std::shared_ptr<std::vector<float>> pjLayerValues; ///< projection layer values
-            std::shared_ptr<std::vector<float>> bpWeights; ///< back propagation weights
-            //std::shared_ptr<std::vector<float>> wordValues; ///< projection layer values
-            //std::shared_ptr<std::vector<float>> wordWeights; ///< back propagation weights
-            std::shared_ptr<std::vector<float>> docValues; ///< document vector
+            std::shared_ptr<const corpus_t> corpus; ///< train data 
+            std::shared_ptr<matrix_t> pjLayerValues; ///< projection layer values
+            std::shared_ptr<matrix_t> bpWeights; ///< back propagation weights
+            std::shared_ptr<matrix_t> docValues; ///< document vector
             std::shared_ptr<std::vector<float>> expTable; ///< exp(x) / (exp(x) + 1) values lookup table
             std::shared_ptr<huffmanTree_t> huffmanTree; ///< Huffman tree used by hierarchical softmax
-            std::shared_ptr<std::atomic<std::size_t>> processedWords; ///< total words processed by train threads
-            std::shared_ptr<std::atomic<float>> alpha; ///< current learning rate
+            std::shared_ptr<nsDistribution_t> nsDistribution; ///< distribution of negative samples
+            std::shared_ptr<downSampling_t> downSampling; ///< thresholds to keep frequent words
+            std::shared_ptr<std::vector<progress_t>> progress; ///< progress of train threads
+            std::shared_ptr<scheduler_t> scheduler; ///< chunks of documents shared by train threads
+            std::shared_ptr<std::vector<replica_t>> pjReplicas; ///< copies of projection layer values in deterministic training
+            std::shared_ptr<std::vector<replica_t>> bpReplicas; ///< copies of back propagation weights in deterministic training
         };
         
     private:
-        std::pair<std::size_t, std::size_t> m_range;
+        std::size_t m_id;
         data_t m_data;
-        std::random_device m_randomDevice;
-        std::mt19937_64 m_randomGenerator;
-        //std::uniform_int_distribution<short> m_rndWindowShift;
-        std::uniform_int_distribution<short> m_rndWindow;
-        std::unique_ptr<downSampling_t> m_downSampling;
-        std::unique_ptr<nsDistribution_t> m_nsDistribution;
-        // word vector
-        std::unique_ptr<std::vector<float>> m_hiddenLayerValues; 
-        std::unique_ptr<std::vector<float>> m_hiddenLayerErrors;
-        // document vector
-        std::unique_ptr<std::vector<float>> m_docLayerValues;
-        std::unique_ptr<std::vector<float>> m_docLayerErrors;
+        float m_alpha; ///< current learning rate
+        random_t m_random; ///< random numbers for the current chunk of documents
+        const kernels_t &m_kernels; ///< kernels for the length of the vectors
+        // model selected by the type and the loss function, or nullptr if the type is unknown
+        typedef void (trainThread_t::*model_t)(const std::vector<unsigned int> &, std::size_t, bool);
+        model_t m_model = nullptr;
+        // copies of the rows updated in a round, or nullptr to update the shared matrices
+        replica_t *m_pjReplica = nullptr;
+        replica_t *m_bpReplica = nullptr;
+        // words processed by this thread and by all the threads before the current round
+        std::size_t m_processedWords = 0;
+        std::size_t m_prvProcessedWords = 0;
+        std::size_t m_roundWords = 0;
+        std::size_t m_roundStart = 0;
+        // values and errors of the hidden layer in aligned rows, initialized by the first update
+        matrix_t m_hiddenLayer;
+        float *m_hiddenLayerValues = nullptr;
+        float *m_hiddenLayerErrors = nullptr;
+        // tokens decoded from a document and sentence read from them
+        std::vector<unsigned int> m_tokens;
+        std::vector<unsigned int> m_sentence;
+        std::size_t m_allocations = 0;
+        // time spent in training and waiting for other threads
+        double m_busy = 0.0;
+        double m_idle = 0.0;
+        std::size_t m_stolen = 0;
+        // mini-batch of a context window
+        matrix_t m_batchErrors;
+        std::vector<float> m_batchGradients;
+        std::vector<std::size_t> m_batchTargets;
         std::unique_ptr<std::thread> m_thread;
 
     public:
@@ -74,38 +111,97 @@ namespace w2v {
          * @param _id thread ID, starting from 0
          * @param _data data object instantiated outside of the thread
         */
-        trainThread_t(const std::pair<std::size_t, std::size_t> &_range, 
-                      const data_t &_data);
+        trainThread_t(std::size_t _id, const data_t &_data);
 
         /// Launchs the thread
-        void launch(int &_iter, float &_alpha) noexcept {
-            m_thread.reset(new std::thread(&trainThread_t::worker, this,
-                                           std::ref(_iter), std::ref(_alpha)));
+        void launch() noexcept {
+            m_thread.reset(new std::thread(&trainThread_t::worker, this));
         }
         /// Joins to the thread
         void join() noexcept {
             return m_thread->join();
         }
+        
+        /// @returns number of times the sentence buffer was enlarged during training
+        std::size_t allocations() const noexcept {return m_allocations;}
+        /// @returns seconds spent in training
+        double busy() const noexcept {return m_busy;}
+        /// @returns seconds spent in waiting for other threads at the end of epochs
+        double idle() const noexcept {return m_idle;}
+        /// @returns number of chunks taken from other threads
+        std::size_t stolen() const noexcept {return m_stolen;}
+        
+        /**
+         * Computes the learning rate that decreases linearly with the words processed
+         * @param _settings settings of the training
+         * @param _processedWords words processed by all the threads
+         * @param _totalWords words to be processed in all the iterations
+        */
+        static float learningRate(const settings_t &_settings, std::size_t _processedWords,
+                                  std::size_t _totalWords) noexcept {
+            float alpha = _settings.alpha * (1 - static_cast<float>(_processedWords) / _totalWords);
+            return std::max(alpha, _settings.alpha * 0.0001f);
+        }
 
     private:
-        void worker(int &_iter, float &_alpha) noexcept;
+        void worker() noexcept;
+        void train(std::pair<std::size_t, std::size_t> _range, std::size_t _stream) noexcept;
+        void merge() noexcept; // merges updates in the round with other threads'
 
-        inline void cbow(const std::vector<unsigned int> &_text, bool freeze) noexcept;
-        inline void sg(const std::vector<unsigned int> &_text, bool freeze) noexcept;
+        // models are compiled for each loss function and take the ID of the document
+        template <bool HS>
+        inline void cbow(const std::vector<unsigned int> &_text, 
+                         std::size_t _id, bool freeze) noexcept;
+        template <bool HS>
+        inline void sg(const std::vector<unsigned int> &_text, 
+                       std::size_t _id, bool freeze) noexcept;
+        inline void sgBatch(const std::vector<unsigned int> &_text, 
+                            std::size_t _id, bool freeze) noexcept; // negative sampling only
+        template <bool HS>
         inline void dm(const std::vector<unsigned int> &_text, 
                        std::size_t _id, bool freeze) noexcept; // for document vector
+        template <bool HS>
         inline void dbow(const std::vector<unsigned int> &_text, 
                          std::size_t _id, bool freeze) noexcept;
         inline void hierarchicalSoftmax(std::size_t _word,
-                                        std::vector<float> &_hiddenLayer,
-                                        std::vector<float> &_trainLayer, 
-                                        std::size_t _trainLayerShift,
+                                        float *_hiddenLayerErrors,
+                                        const float *_hiddenLayerValues,
                                         bool freezeWeights) noexcept;
         inline void negativeSampling(std::size_t _word,
-                                     std::vector<float> &_hiddenLayer,
-                                     std::vector<float> &_trainLayer, 
-                                     std::size_t _trainLayerShift,
+                                     float *_hiddenLayerErrors,
+                                     const float *_hiddenLayerValues,
                                      bool freezeWeights) noexcept;
+        
+        /// Propagates the hidden layer to the output layer by the loss function of the model
+        template <bool HS>
+        inline void loss(std::size_t _word, float *_hiddenLayerErrors,
+                         const float *_hiddenLayerValues, bool freezeWeights) noexcept {
+            if (HS) {
+                hierarchicalSoftmax(_word, _hiddenLayerErrors, _hiddenLayerValues, freezeWeights);
+            } else {
+                negativeSampling(_word, _hiddenLayerErrors, _hiddenLayerValues, freezeWeights);
+            }
+        }
+        
+        /// @returns row of the projection layer values or its copy in the current round
+        inline float *pjRow(std::size_t _i) noexcept {
+            return m_pjReplica ? m_pjReplica->row(_i) : m_data.pjLayerValues->row(_i);
+        }
+        /// @returns row of the back propagation weights or its copy in the current round
+        inline float *bpRow(std::size_t _i) noexcept {
+            return m_bpReplica ? m_bpReplica->row(_i) : m_data.bpWeights->row(_i);
+        }
+        
+        /// @returns exp(x) / (exp(x) + 1) from the lookup table
+        inline float sigmoid(float _f) const noexcept {
+            if (_f < -m_data.settings->expValueMax) {
+                return 0.0f;
+            } else if (_f > m_data.settings->expValueMax) {
+                return 1.0f;
+            }
+            auto r = (_f + m_data.settings->expValueMax) * (m_data.expTable->size() / m_data.settings->expValueMax / 2);
+            return (*m_data.expTable)[static_cast<std::size_t>(r)];
+        }
     };
 
 }
@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @brief variable-byte encoding of token IDs
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#include "vbyte.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define W2V_X86
+#include <immintrin.h>
+#endif
+
+namespace w2v {
+    namespace vbyte {
+        namespace {
+
+            // lengths of the integers in a group and shuffles of their bytes
+            struct tables_t final {
+                uint8_t length[256];
+                uint8_t shuffle[256][16];
+
+                tables_t() {
+                    for (int key = 0; key < 256; ++key) {
+                        uint8_t pos = 0;
+                        for (int j = 0; j < 4; ++j) {
+                            int len = ((key >> (2 * j)) & 3) + 1;
+                            for (int b = 0; b < 4; ++b)
+                                shuffle[key][4 * j + b] = b < len ? pos + b : 0x80; // 0x80 sets zero
+                            pos += len;
+                        }
+                        length[key] = pos;
+                    }
+                }
+            };
+
+            const tables_t &tables() noexcept {
+                static const tables_t t;
+                return t;
+            }
+
+            inline const uint8_t *decodeScalar(const uint8_t *_ctrl, const uint8_t *_data,
+                                               std::size_t _from, std::size_t _n,
+                                               unsigned int *_out) noexcept {
+                for (std::size_t i = _from; i < _n; ++i) {
+                    int len = ((_ctrl[i / 4] >> (2 * (i % 4))) & 3) + 1;
+                    unsigned int v = 0;
+                    for (int b = 0; b < len; ++b)
+                        v |= static_cast<unsigned int>(_data[b]) << (8 * b);
+                    _out[i] = v;
+                    _data += len;
+                }
+                return _data;
+            }
+
+            const uint8_t *decodeGeneric(const uint8_t *_in, std::size_t _n, unsigned int *_out) noexcept {
+                return decodeScalar(_in, _in + (_n + 3) / 4, 0, _n, _out);
+            }
+
+#ifdef W2V_X86
+            __attribute__((target("ssse3")))
+            const uint8_t *decodeSsse3(const uint8_t *_in, std::size_t _n, unsigned int *_out) noexcept {
+                const tables_t &t = tables();
+                const uint8_t *data = _in + (_n + 3) / 4;
+                std::size_t i = 0;
+                for (; i + 4 <= _n; i += 4) {
+                    uint8_t key = _in[i / 4];
+                    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                    __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t.shuffle[key]));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(_out + i), _mm_shuffle_epi8(bytes, mask));
+                    data += t.length[key];
+                }
+                return decodeScalar(_in, data, i, _n, _out);
+            }
+#endif
+
+            typedef const uint8_t *(*decoder_t)(const uint8_t *, std::size_t, unsigned int *);
+
+            decoder_t select() noexcept {
+                tables(); // not to be initialized in the training threads
+#ifdef W2V_X86
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("ssse3"))
+                    return decodeSsse3;
+#endif
+                return decodeGeneric;
+            }
+        }
+
+        void encode(const unsigned int *_in, std::size_t _n, std::vector<uint8_t> &_out) {
+            std::size_t ctrl = _out.size();
+            _out.resize(ctrl + (_n + 3) / 4, 0);
+            for (std::size_t i = 0; i < _n; ++i) {
+                unsigned int v = _in[i];
+                int code = v < (1u << 8) ? 0 : v < (1u << 16) ? 1 : v < (1u << 24) ? 2 : 3;
+                _out[ctrl + i / 4] |= static_cast<uint8_t>(code << (2 * (i % 4)));
+                for (int b = 0; b <= code; ++b)
+                    _out.push_back(static_cast<uint8_t>(v >> (8 * b)));
+            }
+        }
+
+        const uint8_t *decode(const uint8_t *_in, std::size_t _n, unsigned int *_out) noexcept {
+            static const decoder_t decoder = select();
+            return decoder(_in, _n, _out);
+        }
+
+        std::size_t size(const uint8_t *_in, std::size_t _n) noexcept {
+            const tables_t &t = tables();
+            std::size_t nctrl = (_n + 3) / 4;
+            std::size_t bytes = nctrl;
+            for (std::size_t j = 0; j + 1 < nctrl; ++j)
+                bytes += t.length[_in[j]];
+            // unused slots in the last group have no data
+            for (std::size_t i = (nctrl - (nctrl > 0)) * 4; i < _n; ++i)
+                bytes += ((_in[i / 4] >> (2 * (i % 4))) & 3) + 1;
+            return bytes;
+        }
+
+        void encodeVarint(uint64_t _value, std::vector<uint8_t> &_out) {
+            while (_value >= 0x80) {
+                _out.push_back(static_cast<uint8_t>(_value | 0x80));
+                _value >>= 7;
+            }
+            _out.push_back(static_cast<uint8_t>(_value));
+        }
+
+        const uint8_t *decodeVarint(const uint8_t *_in, const uint8_t *_end, uint64_t &_value) noexcept {
+            _value = 0;
+            for (int shift = 0; _in < _end && shift < 64; shift += 7) {
+                uint8_t b = *_in++;
+                _value |= static_cast<uint64_t>(b & 0x7f) << shift;
+                if (b < 0x80)
+                    return _in;
+            }
+            return nullptr;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/**
+ * @file
+ * @brief variable-byte encoding of token IDs
+ * @author Kohei Watanabe
+ * @date 16.10.2026
+ * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
+*/
+
+#ifndef WORD2VEC_VBYTE_H
+#define WORD2VEC_VBYTE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace w2v {
+    /**
+     * @brief vbyte namespace - stream VByte encoding of 32-bit integers
+     *
+     * Integers are encoded in groups of four by a control byte, which holds the lengths of the
+     * integers (1 to 4 bytes), followed by their bytes. The control bytes of a sequence precede its
+     * data, so the integers are decoded by shuffling 16 bytes at a time with SSSE3 on x86.
+     * Lemire, D., Kurz, N., & Rupp, C. (2018). Stream VByte: Faster byte-oriented integer
+     * compression. Information Processing Letters, 130, 1–6.
+    */
+    namespace vbyte {
+        /// number of bytes that the decoder may read past the end of the encoded data
+        const std::size_t padding = 16;
+
+        /// Appends _n integers to _out
+        void encode(const unsigned int *_in, std::size_t _n, std::vector<uint8_t> &_out);
+
+        /**
+         * Decodes _n integers
+         * @param _in encoded data followed by at least `padding` readable bytes
+         * @returns pointer to the end of the encoded data
+         */
+        const uint8_t *decode(const uint8_t *_in, std::size_t _n, unsigned int *_out) noexcept;
+
+        /// @returns number of bytes of _n encoded integers, reading only the control bytes
+        std::size_t size(const uint8_t *_in, std::size_t _n) noexcept;
+
+        /// Appends an integer in LEB128 to _out
+        void encodeVarint(uint64_t _value, std::vector<uint8_t> &_out);
+
+        /**
+         * Decodes an integer in LEB128
+         * @returns pointer to the next byte, or nullptr if the integer does not end before _end
+         */
+        const uint8_t *decodeVarint(const uint8_t *_in, const uint8_t *_end, uint64_t &_value) noexcept;
+    }
+}
+
+#endif // WORD2VEC_VBYTE_H
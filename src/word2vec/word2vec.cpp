@@ -6,29 +6,87 @@
  * @copyright Apache License v.2 (http://www.apache.org/licenses/LICENSE-2.0)
 */
 #include <Rcpp.h>
+#include <thread>
+#include <unordered_map>
 #include "word2vec.hpp"
 #include "trainThread.hpp"
 
 namespace w2v {
+    namespace {
+        void checkInterrupt(void *) {
+            R_CheckUserInterrupt();
+        }
+        
+        /// @returns true if the user pressed Ctrl-C or Esc in R; must be called from the main thread
+        bool userInterrupted() noexcept {
+            return R_ToplevelExec(checkInterrupt, nullptr) == FALSE;
+        }
+    }
+    
+    void word2vec_t::inherit(const settings_t &_settings, const pretrained_t &_model, 
+                             matrix_t &_values, matrix_t &_weights) const {
+        
+        std::size_t nrow = _model.vocabulary.size();
+        std::size_t size = std::min(_values.ncol(), _model.vectorSize);
+        std::size_t nthread = std::max<std::size_t>(std::min<std::size_t>(_settings.threads, nrow / 1024), 1);
+        auto parallel = [&](auto _fun) {
+            std::vector<std::thread> threads;
+            for (std::size_t t = 0; t < nthread; ++t)
+                threads.emplace_back(_fun, nrow * t / nthread, nrow * (t + 1) / nthread);
+            for (auto &thread : threads)
+                thread.join();
+        };
+        
+        // rows of the new model that match the words in the pre-trained model
+        std::unordered_map<std::string, std::size_t> map;
+        map.reserve(m_vocabularySize);
+        for (std::size_t i = 0; i < m_vocabularySize; ++i)
+            map.insert(std::make_pair(m_vocabulary[i], i));
+        std::vector<std::size_t> rows(nrow, SIZE_MAX);
+        parallel([&](std::size_t _from, std::size_t _to) {
+            for (std::size_t j = _from; j < _to; ++j) {
+                if (auto it = map.find(_model.vocabulary[j]); it != map.end())
+                    rows[j] = it->second;
+            }
+        });
+        
+        // read column-major doubles into row-major floats; rows in a block stay in the cache 
+        // while the columns are read contiguously
+        parallel([&](std::size_t _from, std::size_t _to) {
+            const std::size_t block = 64;
+            for (std::size_t j0 = _from; j0 < _to; j0 += block) {
+                std::size_t j1 = std::min(j0 + block, _to);
+                for (std::size_t k = 0; k < size; ++k) {
+                    const double *values = _model.values ? _model.values + k * nrow : nullptr;
+                    const double *weights = _model.weights + k * nrow;
+                    for (std::size_t j = j0; j < j1; ++j) {
+                        if (rows[j] == SIZE_MAX)
+                            continue;
+                        _values.row(rows[j])[k] = values ? static_cast<float>(values[j]) : 0.0f;
+                        _weights.row(rows[j])[k] = static_cast<float>(weights[j]);
+                    }
+                }
+            }
+        });
+    }
+    
     bool word2vec_t::train(const settings_t &_settings,
                            const corpus_t &_corpus,
-                           const word2vec_t &_model) noexcept {
+                           const pretrained_t &_model) noexcept {
         try {
             
-            std::shared_ptr<corpus_t> corpus(new corpus_t(_corpus));
+            std::shared_ptr<const corpus_t> corpus(&_corpus, [](const corpus_t *) {}); // not owned
             std::shared_ptr<settings_t> settings(new settings_t(_settings));
             
             m_vocabulary = corpus->types;
             m_vocabularySize = corpus->types.size();
             m_vectorSize = settings->size;
-            m_corpusSize = corpus->texts.size();
+            m_corpusSize = corpus->size();
             
-            std::size_t matrixSize = m_vectorSize * m_vocabularySize;
-            std::size_t docMatrixSize = 0;
+            std::size_t docMatrixRows = 0;
             if (settings->type > 2) 
-                docMatrixSize = m_vectorSize * m_corpusSize;
+                docMatrixRows = m_corpusSize;
             std::mt19937_64 randomGenerator(settings->random);
-            int iter_max = settings->iterations;
             bool verbose = settings->verbose;
             
             if (m_vectorSize == 0)
@@ -48,17 +106,21 @@ namespace w2v {
             // initialize variables
             std::uniform_real_distribution<float> rndMatrixInitializer(-0.005f, 0.005f);
             
+            auto initialize = [&](matrix_t &_matrix) {
+                for (std::size_t i = 0; i < _matrix.nrow(); ++i) {
+                    float *row = _matrix.row(i);
+                    for (std::size_t k = 0; k < _matrix.ncol(); ++k)
+                        row[k] = rndMatrixInitializer(randomGenerator);
+                }
+            };
+            
             // word vector
-            data.bpWeights.reset(new std::vector<float>(matrixSize, 0.0f));
-            data.pjLayerValues.reset(new std::vector<float>(matrixSize, 0.0f));
-            std::generate((*data.pjLayerValues).begin(), (*data.pjLayerValues).end(), [&]() {
-                return rndMatrixInitializer(randomGenerator);
-            });
+            data.bpWeights.reset(new matrix_t(m_vocabularySize, m_vectorSize, settings->hugePages));
+            data.pjLayerValues.reset(new matrix_t(m_vocabularySize, m_vectorSize, settings->hugePages));
+            initialize(*data.pjLayerValues);
             // document vector
-            data.docValues.reset(new std::vector<float>(docMatrixSize, 0.0f));
-            std::generate((*data.docValues).begin(), (*data.docValues).end(), [&]() {
-                return rndMatrixInitializer(randomGenerator);
-            });
+            data.docValues.reset(new matrix_t(docMatrixRows, m_vectorSize, settings->hugePages));
+            initialize(*data.docValues);
             data.expTable.reset(new std::vector<float>(settings->expTableSize));
             for (uint16_t r = 0; r < settings->expTableSize; ++r) {
                 // scale value between +- expValueMax
@@ -71,39 +133,37 @@ namespace w2v {
             if (settings->withHS) {
                 data.huffmanTree.reset(new huffmanTree_t(corpus->frequency));;
             }
-            data.processedWords.reset(new std::atomic<std::size_t>(0));
-            data.alpha.reset(new std::atomic<float>(settings->alpha));
+            if (settings->negative > 0) {
+                data.nsDistribution.reset(new nsDistribution_t(corpus->frequency, settings->nsPower));
+            }
+            if (settings->sample < 1.0f) {
+                data.downSampling.reset(new downSampling_t(settings->sample, corpus->frequency, 
+                                                           corpus->trainWords));
+            }
+            data.progress.reset(new std::vector<trainThread_t::progress_t>(settings->threads));
             
             // inherit parameters
-            if (_model.m_vocabulary.size() > 0) {
+            if (_model.vocabulary.size() > 0) {
                 if (verbose) {
                     Rprintf(" ......copy pre-trained word vectors\n");
                 }
-                std::unordered_map<std::string, std::size_t> map;
-                for (std::size_t i = 0; i < m_vocabularySize; ++i) {
-                    map.insert(std::make_pair(m_vocabulary[i], i));
-                }
-                for (std::size_t j = 0; j < _model.m_vocabularySize; ++j) {
-                    if (auto it = map.find(_model.m_vocabulary[j]); it != map.end()) {
-                        for (std::size_t k = 0; k < m_vectorSize; k++) {
-                            (*data.pjLayerValues)[k + (it->second * m_vectorSize)] = _model.m_pjLayerValues[k + (j * _model.m_vectorSize)];
-                            (*data.bpWeights)[k + (it->second * m_vectorSize)] = _model.m_bpWeights[k + (j * _model.m_vectorSize)];
-                        }
-                    }
-                }
+                inherit(*settings, _model, *data.pjLayerValues, *data.bpWeights);
             }
             
             // create threads
             std::vector<std::unique_ptr<trainThread_t>> threads;
-            std::size_t n = data.corpus->texts.size();
-            std::size_t per = ceil((float)n / (float)data.settings->threads);
-            for (std::size_t i = 0; i < settings->threads; ++i) {
-                std::size_t from = per * i;
-                std::size_t to = std::min(per * (i + 1) - 1, n - 1);
-                //Rcpp::Rcout << settings->threads << " " << per << " " << from << " " << to << "\n";
-                threads.emplace_back(new trainThread_t(std::make_pair(from, to), data));
-                if (n - 1 == to) 
-                    break;
+            std::size_t nthread = std::min<std::size_t>(settings->threads, data.corpus->size());
+            data.scheduler.reset(new scheduler_t(*corpus, nthread, 16, !settings->deterministic));
+            if (settings->deterministic && nthread > 1) {
+                data.pjReplicas.reset(new std::vector<replica_t>());
+                data.bpReplicas.reset(new std::vector<replica_t>());
+                for (std::size_t i = 0; i < nthread; ++i) {
+                    data.pjReplicas->emplace_back(*data.pjLayerValues);
+                    data.bpReplicas->emplace_back(*data.bpWeights);
+                }
+            }
+            for (std::size_t i = 0; i < nthread; ++i) {
+                threads.emplace_back(new trainThread_t(i, data));
             }
             
             if (verbose) {
@@ -116,35 +176,77 @@ namespace w2v {
                 }
             } 
             
-            int iter = 0;
-            float alpha = 0.0;
             for (auto &thread:threads) {
-                thread->launch(iter, alpha);
+                thread->launch();
             }
             
-            if (verbose) {
-                int iter_prev = 0;
-                auto start = std::chrono::high_resolution_clock::now();
-                while (iter < iter_max) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                    if (iter_prev < iter) {
-                        auto end = std::chrono::high_resolution_clock::now();
-                        auto diff = std::chrono::duration<double, std::milli>(end - start);
-                        double msec = diff.count();
+            // report progress and check user interrupt until the threads finish all the epochs
+            std::size_t wordsPerAllThreads = settings->iterations * corpus->trainWords;
+            auto start = std::chrono::steady_clock::now();
+            auto last = start;
+            std::size_t epoch = 0;
+            bool interrupted = false;
+            while (epoch < settings->iterations) {
+                std::size_t next = data.scheduler->waitFor(epoch, std::chrono::milliseconds(100));
+                if (interrupted) {
+                    if (next != epoch)
+                        break; // threads stopped at the end of the epoch
+                    continue;
+                }
+                if (userInterrupted()) {
+                    data.scheduler->cancel();
+                    interrupted = true;
+                    continue;
+                }
+                if (verbose) {
+                    auto now = std::chrono::steady_clock::now();
+                    double elapsed = std::chrono::duration<double>(now - start).count();
+                    std::size_t processed = 0, minWords = SIZE_MAX, maxWords = 0;
+                    for (std::size_t i = 0; i < threads.size(); ++i) {
+                        std::size_t words = (*data.progress)[i].processedWords.load(std::memory_order_relaxed);
+                        processed += words;
+                        minWords = std::min(minWords, words);
+                        maxWords = std::max(maxWords, words);
+                    }
+                    float alpha = trainThread_t::learningRate(*settings, processed, wordsPerAllThreads);
+                    if (next != epoch) {
                         Rprintf(" ......iteration %d elapsed time: %.2f seconds (alpha: %.4f)\n",
-                                iter, msec / 1000, alpha);
-                        iter_prev = iter;
+                                (int)next, elapsed, alpha);
+                    } else if (settings->interval > 0 && 
+                               std::chrono::duration<double>(now - last).count() >= settings->interval) {
+                        double ratio = static_cast<double>(processed) / wordsPerAllThreads;
+                        double remaining = ratio > 0 ? elapsed * (1 - ratio) / ratio : 0;
+                        Rprintf(" ......%.1f%% processed at %.0f words/sec (%.0f-%.0f per thread, alpha: %.4f), "
+                                "%.0f seconds remaining\n",
+                                ratio * 100, processed / elapsed, minWords / elapsed, maxWords / elapsed, 
+                                alpha, remaining);
+                        last = now;
                     }
                 }
+                epoch = next;
             }
             
+            m_allocations = 0;
             for (auto &thread:threads) {
                 thread->join();
+                m_allocations += thread->allocations();
+            }
+            if (interrupted)
+                throw std::runtime_error("interrupted by the user");
+            if (verbose && m_allocations > 0) {
+                Rprintf(" ......%d buffers reallocated in training\n", (int)m_allocations);
+            }
+            if (verbose && threads.size() > 1) {
+                for (std::size_t i = 0; i < threads.size(); ++i) {
+                    Rprintf(" ......thread %d busy: %.2f seconds idle: %.2f seconds (%d chunks stolen)\n",
+                            (int)i + 1, threads[i]->busy(), threads[i]->idle(), (int)threads[i]->stolen());
+                }
             }
             
-            m_pjLayerValues = *data.pjLayerValues;
-            m_bpWeights = *data.bpWeights;
-            m_docValues = *data.docValues;
+            // keep the matrices without copying
+            m_pjLayerValues = std::move(*data.pjLayerValues);
+            m_bpWeights = std::move(*data.bpWeights);
+            m_docValues = std::move(*data.docValues);
             
             return true;
             
@@ -12,56 +12,203 @@
 #include <cassert>
 #include <string>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <exception>
 #include <queue>
 #include <functional>
 #include <cmath>
 #include <stdexcept>
+#include <algorithm>
+#include <numeric>
 
-typedef std::vector<std::string> types_t;
-typedef std::vector<unsigned int> text_t;
-typedef std::vector<text_t> texts_t;
-typedef std::vector<size_t> frequency_t;
+#include "matrix.hpp"
+#include "source.hpp"
 
 namespace w2v {
     
     /**
      * @brief corpus stores tokens
+     * 
+     * The corpus reads documents from a source shared with the caller. Types can be removed from
+     * the vocabulary by trim() without changing the source; their tokens are treated as padding.
      */    
     class corpus_t final {
+    private:
+        std::shared_ptr<const source_t> m_source;
+        std::vector<unsigned int> m_ids; // new IDs of the types in the source, or empty if not trimmed
+        
     public:
-        texts_t texts;
         types_t types;
         frequency_t frequency;
-        size_t totalWords;
-        size_t trainWords;
+        size_t totalWords = 0;
+        size_t trainWords = 0;
+        size_t maxLength = 0; // length of the longest document
+        std::vector<unsigned int> docWords; // number of words in each document
         
         // constructors
-        corpus_t(): texts() {}
-        corpus_t(texts_t _texts, types_t _types): 
-                 texts(_texts), types(_types) {}
+        corpus_t() = default;
+        corpus_t(const texts_t &_texts, const types_t &_types): 
+                 m_source(std::make_shared<memorySource_t>(_texts)), types(_types) {}
+        corpus_t(std::shared_ptr<const source_t> _source, const types_t &_types): 
+                 m_source(std::move(_source)), types(_types) {}
+        
+        // @returns number of documents
+        std::size_t size() const noexcept {return m_source ? m_source->size() : 0;}
+        // @returns number of tokens in the h-th document
+        std::size_t length(std::size_t _h) const noexcept {return m_source->length(_h);}
+        // @returns tokens in the h-th document, decoded into _buffer if necessary
+        textView_t text(std::size_t _h, text_t &_buffer) const {return m_source->text(_h, _buffer);}
+        // @returns source of the documents
+        const source_t &source() const noexcept {return *m_source;}
+        // @returns ID of a token in the vocabulary, or 0 if removed
+        unsigned int id(unsigned int _token) const noexcept {
+            return m_ids.empty() ? _token : m_ids[_token];
+        }
 
-        void setWordFreq() {
+        /**
+         * Counts words in the documents
+         * @param _threads number of threads that count the documents in blocks
+         */
+        void setWordFreq(std::size_t _threads = 1) {
+            
+            std::size_t n = size();
+            std::size_t limit = m_ids.empty() ? types.size() : m_ids.size() - 1; // largest valid ID
+            docWords = std::vector<unsigned int>(n, 0);
             
+            // documents are read in blocks to keep pages of files in memory only while counted
+            const std::size_t block = 4096;
+            std::size_t nblock = (n + block - 1) / block;
+            std::size_t nthread = std::max<std::size_t>(std::min(_threads, nblock), 1);
+            std::atomic<std::size_t> next(0);
+            std::atomic<bool> invalid(false);
+            std::exception_ptr error;
+            // counts of padding (0) and words in each thread, and lengths of the longest documents
+            std::vector<frequency_t> counts(nthread, frequency_t(types.size() + 1, 0));
+            std::vector<std::size_t> lengths(nthread, 0);
+            auto counter = [&](std::size_t _t) {
+                frequency_t &hist = counts[_t];
+                try {
+                    text_t buffer;
+                    for (std::size_t b = next++; b < nblock && !invalid; b = next++) {
+                        std::size_t first = b * block;
+                        std::size_t last = std::min(first + block, n);
+                        m_source->prefetch(first, last);
+                        for (std::size_t h = first; h < last; h++) {
+                            textView_t text = this->text(h, buffer);
+                            if (text.size() == 0)
+                                continue;
+                            // IDs are checked once per document to count them without branches
+                            if (*std::max_element(text.begin(), text.end()) > limit)
+                                throw std::range_error("invalid token object");
+                            std::size_t padding = hist[0];
+                            for (auto word : text)
+                                hist[id(word)]++;
+                            docWords[h] = text.size() - (hist[0] - padding);
+                            lengths[_t] = std::max(lengths[_t], text.size());
+                        }
+                        m_source->release(first, last);
+                    }
+                } catch (...) {
+                    if (!invalid.exchange(true))
+                        error = std::current_exception();
+                }
+            };
+            std::vector<std::thread> threads;
+            for (std::size_t t = 1; t < nthread; t++)
+                threads.emplace_back(counter, t);
+            counter(0);
+            for (auto &thread : threads)
+                thread.join();
+            if (error)
+                std::rethrow_exception(error);
+            
+            // merged in the same order regardless of the number of threads
             frequency = frequency_t(types.size(), 0);
             totalWords = 0;
             trainWords = 0;
-            for (size_t h = 0; h < texts.size(); h++) {
-                text_t text = texts[h];
-                for (size_t i = 0; i < text.size(); i++) {
-                    totalWords++;
-                    auto &word = text[i];
-                    if (word < 0 || types.size() < word)
-                        throw std::range_error("invalid token object");
-                    if (word == 0) // padding
-                        continue;
-                    frequency[word - 1]++;
-                    trainWords++;
+            maxLength = 0;
+            for (std::size_t t = 0; t < nthread; t++) {
+                totalWords += counts[t][0];
+                for (std::size_t i = 0; i < types.size(); i++) {
+                    frequency[i] += counts[t][i + 1];
+                    totalWords += counts[t][i + 1];
+                    trainWords += counts[t][i + 1];
                 }
+                maxLength = std::max(maxLength, lengths[t]);
+            }
+        }
+        
+        /**
+         * Removes types less frequent than a threshold from the vocabulary
+         * @param _minCount minimum frequency of types
+         */
+        void trim(size_t _minCount, std::size_t _threads = 1) {
+            
+            if (frequency.size() != types.size())
+                setWordFreq(_threads);
+            bool trimmed = false;
+            for (auto f : frequency)
+                trimmed = trimmed || f < _minCount;
+            if (!trimmed)
+                return;
+            
+            std::vector<unsigned int> ids(types.size() + 1, 0);
+            types_t types2;
+            for (size_t i = 0; i < types.size(); i++) {
+                if (frequency[i] < _minCount)
+                    continue;
+                types2.push_back(types[i]);
+                ids[i + 1] = types2.size();
+            }
+            remap(ids);
+            types = std::move(types2);
+            setWordFreq(_threads); // without the removed words
+        }
+        
+        /**
+         * Sorts types by frequency, so that frequent words are close to each other in the matrices
+         * @returns new positions of the types before sorting
+         */
+        std::vector<size_t> sort() {
+            
+            if (frequency.size() != types.size())
+                setWordFreq();
+            std::vector<size_t> order(types.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](size_t _a, size_t _b) {
+                return frequency[_a] > frequency[_b];
+            });
+            
+            std::vector<size_t> rows(types.size());
+            std::vector<unsigned int> ids(types.size() + 1, 0);
+            types_t types2(types.size());
+            frequency_t frequency2(types.size());
+            bool sorted = true;
+            for (size_t j = 0; j < order.size(); j++) {
+                rows[order[j]] = j;
+                ids[order[j] + 1] = j + 1;
+                types2[j] = std::move(types[order[j]]);
+                frequency2[j] = frequency[order[j]];
+                sorted = sorted && order[j] == j;
+            }
+            if (!sorted)
+                remap(ids);
+            types = std::move(types2);
+            frequency = std::move(frequency2);
+            return rows;
+        }
+        
+    private:
+        // changes IDs of types to _ids, composed with the existing mapping
+        void remap(std::vector<unsigned int> &_ids) {
+            if (m_ids.empty()) {
+                m_ids = std::move(_ids);
+            } else {
+                for (auto &j : m_ids)
+                    j = _ids[j];
             }
-            // Rcpp::Rcout << "trainWords: " << trainWords << "\n";
-            // Rcpp::Rcout << "totalWords: " << totalWords << "\n";
-            // Rcpp::Rcout << "frequency.size(): " << frequency.size() << "\n";
-            // Rcpp::Rcout << "words.size(): " << words.size() << "\n";
         }
     };
     
@@ -76,14 +223,31 @@ namespace w2v {
         float sample = 1e-3f; //< threshold for occurrence of words
         bool withHS = false; //< use hierarchical softmax instead of negative sampling
         uint16_t negative = 5; //< negative examples number
+        float nsPower = 0.75f; //< exponent of word frequency in the distribution of negative examples
+        bool batch = false; //< share negative examples within a context window (skip-gram only)
         uint16_t threads = 1; //< train threads number
         uint16_t iterations = 5; //< train iterations
         float alpha = 0.05f; //< starting learn rate
         int type = 1; //< 1:CBOW 2:Skip-Gram 3:CBOW (doc2vec) 4:Skip-Gram (doc2vec)
         uint32_t random = 1234; // < random number seed
+        bool hugePages = false; // allocate large matrices from huge pages
         bool verbose = false; // print progress
+        float interval = 10.0f; // seconds between progress messages
+        bool deterministic = false; // merge updates of threads in a fixed order to reproduce results
         settings_t() = default;
     };
+    
+    /**
+     * @brief pretrained structure refers to the matrices of a pre-trained model
+     * 
+     * The matrices are column-major with a row for each word as in R, and are not owned.
+     */
+    struct pretrained_t final {
+        std::vector<std::string> vocabulary; //< words in the rows
+        std::size_t vectorSize = 0; //< number of columns
+        const double *values = nullptr; //< word vectors, or nullptr if not saved
+        const double *weights = nullptr; //< back propagation weights
+    };
 
 
     class word2vec_t final {
@@ -95,12 +259,15 @@ namespace w2v {
         
         // word vector
         std::size_t m_vectorSize = 0;
-        std::vector<float> m_pjLayerValues;
-        std::vector<float> m_bpWeights;
+        matrix_t m_pjLayerValues;
+        matrix_t m_bpWeights;
         
         // document vector
         std::size_t m_corpusSize = 0;
-        std::vector<float> m_docValues;
+        matrix_t m_docValues;
+        
+        // allocations in the training threads
+        std::size_t m_allocations = 0;
         
         mutable std::string m_errMsg;
         
@@ -108,22 +275,18 @@ namespace w2v {
         
         // constructor
         word2vec_t() {};
-        word2vec_t(std::vector<std::string> vocabulary_,
-                   std::size_t vectorSize_,
-                   std::vector<float> pjLayerValues_,
-                   std::vector<float> bpWeights_): 
-                   m_vocabulary(vocabulary_),
-                   m_vocabularySize(vocabulary_.size()),
-                   m_vectorSize(vectorSize_),
-                   m_pjLayerValues(pjLayerValues_),
-                   m_bpWeights(bpWeights_) {}
+        
+        // moving only because the matrices are large
+        word2vec_t(word2vec_t &&) = default;
+        word2vec_t &operator=(word2vec_t &&) = default;
     
         // virtual destructor
         virtual ~word2vec_t() = default;
         
-        const std::vector<float> &values() {return m_pjLayerValues;}  // TODO: change to wordValues
-        const std::vector<float> &weights() {return m_bpWeights;}
-        const std::vector<float> &docValues() {return m_docValues;} 
+        // rows are words or documents, padded to matrix_t::stride()
+        const matrix_t &values() const noexcept {return m_pjLayerValues;}  // TODO: change to wordValues
+        const matrix_t &weights() const noexcept {return m_bpWeights;}
+        const matrix_t &docValues() const noexcept {return m_docValues;} 
         
         // @returns m_corpusSize size (number of documents)
         std::size_t corpusSize() const noexcept {return m_corpusSize;}
@@ -133,13 +296,15 @@ namespace w2v {
         std::size_t vocabularySize() const noexcept {return m_vocabularySize;}
         // @returns vector size of model
         std::vector<std::string> vocabulary() const noexcept {return m_vocabulary;}
+        // @returns number of heap allocations made by the training threads after initialization
+        std::size_t allocations() const noexcept {return m_allocations;}
         // @returns error message
         std::string errMsg() const noexcept {return m_errMsg;}
         
         // train model
         bool train(const settings_t &_settings,
                    const corpus_t &_corpus,
-                   const word2vec_t &_model) noexcept;
+                   const pretrained_t &_model) noexcept;
         
         // normalize by factors
         // void normalizeValues() {
@@ -157,6 +322,10 @@ namespace w2v {
         //     }
         // }
         
+    private:
+        // copy pre-trained vectors to the rows of the same words
+        void inherit(const settings_t &_settings, const pretrained_t &_model, 
+                     matrix_t &_values, matrix_t &_weights) const;
     };
 }
 #endif // WORD2VEC_WORD2VEC_HPP
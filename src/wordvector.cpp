@@ -8,7 +8,6 @@
 
 typedef XPtr<TokensObj> TokensPtr;
 typedef std::vector<std::string> vocabulary_t;
-typedef std::vector<float> wordvector_t;
 
 
 Rcpp::CharacterVector encode(std::vector<std::string> types){
@@ -21,89 +20,109 @@ Rcpp::CharacterVector encode(std::vector<std::string> types){
     return types_;
 }
 
-Rcpp::NumericMatrix as_matrix(std::vector<float> mat, 
-                              std::size_t nrow, std::size_t ncol) {
+// transpose row-major float matrix to column-major double matrix in one pass
+// rows are the positions of the output rows in mat, or empty if not reordered
+Rcpp::NumericMatrix as_matrix(const w2v::matrix_t &mat, 
+                              const std::vector<std::size_t> &rows = {}) {
     
-    if (mat.size() == 0)
+    if (mat.empty())
         return Rcpp::NumericMatrix();
-    if (nrow * ncol != mat.size())
-        throw std::runtime_error("Invalid matrix size");
+    std::size_t nrow = mat.nrow();
+    std::size_t ncol = mat.ncol();
     Rcpp::NumericMatrix mat_(nrow, ncol);
-    for (std::size_t i = 0; i < nrow; ++i) {
+    double *dst = mat_.begin();
+    // rows in a block stay in the cache while their columns are written contiguously
+    const std::size_t block = 64;
+    for (std::size_t i0 = 0; i0 < nrow; i0 += block) {
+        std::size_t i1 = std::min(i0 + block, nrow);
         for (std::size_t j = 0; j < ncol; ++j) {
-            mat_(i, j) = mat[i * ncol + j];
+            double *col = dst + j * nrow;
+            for (std::size_t i = i0; i < i1; ++i)
+                col[i] = mat.row(rows.empty() ? i : rows[i])[j];
         }
     }
     return mat_;
 }
 
+// words in the order of the types before sorting by frequency
+template <typename T>
+std::vector<T> reorder(const std::vector<T> &vec, const std::vector<std::size_t> &rows) {
+    std::vector<T> vec2(rows.size());
+    for (std::size_t i = 0; i < rows.size(); i++)
+        vec2[i] = vec[rows[i]];
+    return vec2;
+}
+
 
-Rcpp::NumericMatrix get_weights(w2v::word2vec_t model) {
-    std::vector<float> mat = model.weights();
-    if (model.vectorSize() * model.vocabularySize() != mat.size())
+Rcpp::NumericMatrix get_weights(const w2v::word2vec_t &model, const std::vector<std::size_t> &rows) {
+    const w2v::matrix_t &mat = model.weights();
+    if (model.vectorSize() != mat.ncol() || model.vocabularySize() != mat.nrow() || 
+        model.vocabularySize() != rows.size())
         throw std::runtime_error("Invalid weight matrix");
-    Rcpp::NumericMatrix mat_ = as_matrix(mat, model.vocabularySize(), model.vectorSize());
-    rownames(mat_) = encode(model.vocabulary()); 
+    Rcpp::NumericMatrix mat_ = as_matrix(mat, rows);
+    rownames(mat_) = encode(reorder(model.vocabulary(), rows)); 
     return mat_;
 }
 
-Rcpp::NumericMatrix get_words(w2v::word2vec_t model) {
-    std::vector<float> mat = model.values();
-    if (model.vectorSize() * model.vocabularySize() != mat.size())
+Rcpp::NumericMatrix get_words(const w2v::word2vec_t &model, const std::vector<std::size_t> &rows) {
+    const w2v::matrix_t &mat = model.values();
+    if (model.vectorSize() != mat.ncol() || model.vocabularySize() != mat.nrow() || 
+        model.vocabularySize() != rows.size())
         throw std::runtime_error("Invalid word matrix");
-    Rcpp::NumericMatrix mat_ = as_matrix(mat, model.vocabularySize(), model.vectorSize());
-    rownames(mat_) = encode(model.vocabulary()); 
+    Rcpp::NumericMatrix mat_ = as_matrix(mat, rows);
+    rownames(mat_) = encode(reorder(model.vocabulary(), rows)); 
     return mat_;
 }
 
-Rcpp::NumericMatrix get_documents(w2v::word2vec_t model) {
-    std::vector<float> mat = model.docValues();
-    if (model.vectorSize() * model.corpusSize() != mat.size())
+Rcpp::NumericMatrix get_documents(const w2v::word2vec_t &model) {
+    const w2v::matrix_t &mat = model.docValues();
+    if (model.vectorSize() != mat.ncol() || model.corpusSize() != mat.nrow())
         throw std::runtime_error("Invalid document matrix");
-    Rcpp::NumericMatrix mat_ = as_matrix(mat, model.corpusSize(), model.vectorSize());
+    Rcpp::NumericMatrix mat_ = as_matrix(mat);
     // TODO: add document names here
     return mat_;
 }
 
-Rcpp::NumericVector get_frequency(w2v::corpus_t corpus) {
-    Rcpp::NumericVector vec_ = Rcpp::wrap(corpus.frequency);
-    vec_.names() = encode(corpus.types);
+Rcpp::NumericVector get_frequency(const w2v::corpus_t &corpus, const std::vector<std::size_t> &rows) {
+    Rcpp::NumericVector vec_ = Rcpp::wrap(reorder(corpus.frequency, rows));
+    vec_.names() = encode(reorder(corpus.types, rows));
     return vec_;
 }
 
-w2v::word2vec_t as_word2vec(List model_) {
+// refers to the matrices in model_, which must be protected until training ends
+w2v::pretrained_t as_pretrained(List model_) {
     
-    w2v::word2vec_t model;
+    w2v::pretrained_t model;
     if (model_.length() == 0)
         return model;
     
-    std::size_t dim;
-    vocabulary_t vocabulary;
-    wordvector_t words, weights;
-    
     // vector sizes
-    dim = as<Rcpp::IntegerVector>(model_["dim"])[0];
+    model.vectorSize = as<Rcpp::IntegerVector>(model_["dim"])[0];
     
     // vocabulary
     CharacterVector vocabulary_ = as<Rcpp::NumericVector>(model_["frequency"]).names();
-    vocabulary = Rcpp::as<vocabulary_t>(vocabulary_);
+    model.vocabulary = Rcpp::as<vocabulary_t>(vocabulary_);
+    std::size_t nrow = model.vocabulary.size();
     
     // word vectors
     Rcpp::List values_ = model_["values"];
     if (values_.containsElementNamed("word")) {
+        if (!Rf_isReal(values_["word"])) // not to be coerced to a temporary object
+            throw std::runtime_error("Invalid word matrix");
         Rcpp::NumericMatrix words_ = values_["word"];
-        words_ = Rcpp::transpose(words_); // columns are words internally
-        words = Rcpp::as<wordvector_t>(NumericVector(words_));
-    } else {
-        words = wordvector_t(dim * vocabulary.size()); // TODO: change to empty matrix
+        if ((std::size_t)words_.nrow() != nrow || (std::size_t)words_.ncol() < model.vectorSize)
+            throw std::runtime_error("Invalid word matrix");
+        model.values = words_.begin();
     }
     
     // weights
+    if (!Rf_isReal(model_["weights"]))
+        throw std::runtime_error("Invalid weight matrix");
     Rcpp::NumericMatrix weights_ = model_["weights"];
-    weights_ = Rcpp::transpose(weights_); // columns are words internally
-    weights = Rcpp::as<wordvector_t>(NumericVector(weights_));
+    if ((std::size_t)weights_.nrow() != nrow || (std::size_t)weights_.ncol() < model.vectorSize)
+        throw std::runtime_error("Invalid weight matrix");
+    model.weights = weights_.begin();
     
-    model = w2v::word2vec_t(vocabulary, dim, words, weights);
     return model;
 }
 
@@ -115,6 +134,8 @@ w2v::word2vec_t as_word2vec(List model_) {
  float sample = 1e-3f; ///< threshold for occurrence of words
  bool withHS = false; ///< use hierarchical softmax instead of negative sampling
  uint16_t negative = 5; ///< negative examples number
+ float nsPower = 0.75f; ///< exponent of word frequency in the distribution of negative examples
+ bool batch = false; ///< share negative examples within a context window
  uint16_t threads = 1; ///< train threads number
  uint16_t iterations = 5; ///< train iterations
  float alpha = 0.05f; ///< starting learn rate
@@ -122,20 +143,26 @@ w2v::word2vec_t as_word2vec(List model_) {
 */
 
 // [[Rcpp::export]]
-Rcpp::List cpp_word2vec(TokensPtr xptr, 
+Rcpp::List cpp_word2vec(SEXP x_, 
                         List model,
                         uint16_t size = 100,
                         uint16_t window = 5,
                         float sample = 0.001,
                         bool withHS = false,
                         uint16_t negative = 5,
+                        float nsPower = 0.75,
+                        bool batch = false,
                         uint16_t threads = 1,
                         uint16_t iterations = 5,
                         float alpha = 0.05,
                         int type = 1,
                         bool doc2vec = false,
                         bool verbose = false,
-                        bool normalize = true) {
+                        bool normalize = true,
+                        bool hugePages = false,
+                        bool deterministic = false,
+                        float interval = 10,
+                        int minCount = 0) {
   
     if (verbose) {
         if (type == 1) {
@@ -153,12 +180,21 @@ Rcpp::List cpp_word2vec(TokensPtr xptr,
         Rprintf(" ...initializing\n");
     }
     
-    xptr->recompile();
-    texts_t texts = xptr->texts;
-    types_t types = xptr->types;
-    
-    w2v::corpus_t corpus(texts, types);
-    corpus.setWordFreq();
+    w2v::corpus_t corpus;
+    if (Rf_isString(x_)) {
+        // tokens are read from the file while training
+        auto source = std::make_shared<w2v::fileSource_t>(Rcpp::as<std::string>(x_));
+        corpus = w2v::corpus_t(source, source->types());
+    } else {
+        TokensPtr xptr(x_);
+        xptr->recompile();
+        corpus = w2v::corpus_t(xptr->texts, xptr->types); // refers to tokens in xptr
+    }
+    std::size_t nthread = threads > 0 ? threads : std::thread::hardware_concurrency();
+    corpus.setWordFreq(nthread);
+    corpus.trim(std::max(minCount, 0), nthread);
+    // frequent words share pages and cache lines in the matrices
+    std::vector<std::size_t> rows = corpus.sort();
       
     w2v::settings_t settings;;
     settings.size = size;
@@ -168,15 +204,20 @@ Rcpp::List cpp_word2vec(TokensPtr xptr,
     settings.sample = sample;
     settings.withHS = withHS;
     settings.negative = negative;
-    settings.threads = threads > 0 ? threads : std::thread::hardware_concurrency();
+    settings.nsPower = nsPower;
+    settings.batch = batch;
+    settings.threads = nthread;
     settings.iterations = iterations;
     settings.alpha = alpha;
     settings.type = type;
     settings.random = (uint32_t)(Rcpp::runif(1)[0] * std::numeric_limits<uint32_t>::max());
     settings.verbose = verbose;
+    settings.hugePages = hugePages;
+    settings.deterministic = deterministic;
+    settings.interval = interval;
     
     // NOTE: consider initializing models with corpus
-    w2v::word2vec_t word2vec_pre = as_word2vec(model);
+    w2v::pretrained_t word2vec_pre = as_pretrained(model);
     w2v::word2vec_t word2vec;
     bool trained;
     
@@ -199,28 +240,39 @@ Rcpp::List cpp_word2vec(TokensPtr xptr,
             );
         } else { // dm
             values = Rcpp::List::create(
-                Rcpp::Named("word") = get_words(word2vec), 
+                Rcpp::Named("word") = get_words(word2vec, rows), 
                 Rcpp::Named("doc") = get_documents(word2vec)
             );
         }
     } else { // cbow, sg, dm
         values = Rcpp::List::create(
-            Rcpp::Named("word") = get_words(word2vec)
+            Rcpp::Named("word") = get_words(word2vec, rows)
         );
     }
     Rcpp::List res = Rcpp::List::create(
         Rcpp::Named("values") = values,
-        Rcpp::Named("weights") = get_weights(word2vec), 
+        Rcpp::Named("weights") = get_weights(word2vec, rows), 
         Rcpp::Named("type") = type,
         Rcpp::Named("dim") = size,
-        Rcpp::Named("frequency") = get_frequency(corpus),
+        Rcpp::Named("frequency") = get_frequency(corpus, rows),
         Rcpp::Named("window") = window,
         Rcpp::Named("iter") = iterations,
         Rcpp::Named("alpha") = alpha,
         Rcpp::Named("use_ns") = !withHS,
         Rcpp::Named("ns_size") = negative,
+        Rcpp::Named("ns_power") = nsPower,
         Rcpp::Named("sample") = sample,
         Rcpp::Named("normalize") = normalize
     );
+    if (doc2vec)
+        res["ntoken"] = Rcpp::IntegerVector(corpus.docWords.begin(), corpus.docWords.end());
+    // heap allocations in the training threads, which should be zero
+    res.attr("allocations") = static_cast<int>(word2vec.allocations());
     return res;
 }
+
+// [[Rcpp::export]]
+void cpp_write_tokens(TokensPtr xptr, std::string file) {
+    xptr->recompile();
+    w2v::fileSource_t::write(file, w2v::memorySource_t(xptr->texts), xptr->types);
+}
@@ -0,0 +1,69 @@
+// Micro-benchmark of the vector kernels in src/word2vec/kernels.cpp
+//
+// g++ -std=c++17 -O2 -I src tests/misc/bench_kernels.cpp src/word2vec/kernels.cpp -o bench_kernels
+// ./bench_kernels
+//
+// Each kernel is applied to rows of a matrix large enough to spill the L1 cache, as in the
+// negative sampling where the rows of the output layer are picked randomly. Rows are padded to
+// multiples of 16 floats as in matrix_t, and kernels specialized for their length are compared
+// with those for any length (marked by *).
+//--------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "word2vec/kernels.hpp"
+
+int main() {
+
+    const std::size_t nrow = 10000;
+    const std::size_t nrep = 2000000;
+    std::mt19937_64 gen(1234);
+    std::uniform_real_distribution<float> rnd(-0.5f, 0.5f);
+    std::uniform_int_distribution<std::size_t> row(0, nrow - 1);
+
+    std::printf("%-8s %5s %12s %12s %12s %8s\n", "kernel", "dim", "dot", "axpy", "dualAxpy", "speedup");
+    for (std::size_t size : {50, 100, 300}) {
+        std::size_t dim = (size + 15) / 16 * 16;
+        std::vector<float> mat(nrow * dim), hidden(dim), error(dim);
+        for (auto &v : mat) v = rnd(gen);
+        for (auto &v : hidden) v = rnd(gen);
+        std::vector<std::size_t> rows(nrep);
+        for (auto &r : rows) r = row(gen) * dim;
+
+        double base = 0.0;
+        for (const char *name : {"generic", "sse", "avx2", "avx512"}) {
+            for (std::size_t n : {std::size_t(0), dim}) {
+                const w2v::kernels_t *k = w2v::kernels(name, n);
+                if (!k)
+                    continue;
+                double msec[3];
+                volatile float sink = 0.0f;
+                for (int op = 0; op < 3; ++op) {
+                    auto start = std::chrono::high_resolution_clock::now();
+                    for (std::size_t i = 0; i < nrep; ++i) {
+                        float *w = mat.data() + rows[i];
+                        if (op == 0) {
+                            sink = sink + k->dot(hidden.data(), w, dim);
+                        } else if (op == 1) {
+                            k->axpy(1e-6f, w, error.data(), dim);
+                        } else {
+                            k->dualAxpy(1e-6f, hidden.data(), w, error.data(), dim);
+                        }
+                    }
+                    auto end = std::chrono::high_resolution_clock::now();
+                    msec[op] = std::chrono::duration<double, std::milli>(end - start).count();
+                }
+                double total = msec[0] + msec[1] + msec[2];
+                if (base == 0.0)
+                    base = total;
+                std::string label = std::string(name) + (k->length ? "*" : "");
+                std::printf("%-8s %5zu %10.1fms %10.1fms %10.1fms %7.2fx\n", label.c_str(), size,
+                            msec[0], msec[1], msec[2], base / total);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Benchmark of sorting the vocabulary by frequency in src/word2vec/word2vec.hpp
+//
+// g++ -std=c++17 -O2 -pthread -I src $(R CMD config --cppflags) \
+//     $(Rscript -e "Rcpp:::CxxFlags()") tests/misc/bench_vocab.cpp src/word2vec/*.cpp \
+//     -o bench_vocab $(R CMD config --ldflags)
+// ./bench_vocab [type] [threads] [dim]
+//
+// Models are trained on a Zipfian corpus whose types are numbered in the order of their first
+// occurrences as in quanteda, with and without sorting the types by frequency. Misses of the
+// caches and the TLB are counted by the hardware performance counters on Linux (set 
+// /proc/sys/kernel/perf_event_paranoid to 2 or lower).
+//--------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "word2vec/word2vec.hpp"
+
+// counter of a hardware event in this process and its threads
+class counter_t {
+    int m_fd = -1;
+public:
+    counter_t(uint32_t _type, uint64_t _config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = _type;
+        attr.config = _config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~counter_t() {if (m_fd >= 0) close(m_fd);}
+    void start() {ioctl(m_fd, PERF_EVENT_IOC_RESET, 0); ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);}
+    void stop() {ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);}
+    double value() const {
+        uint64_t v = 0;
+        if (m_fd < 0 || read(m_fd, &v, sizeof(v)) != sizeof(v))
+            return NAN;
+        return v;
+    }
+};
+
+uint64_t cache(uint64_t _cache, uint64_t _result) {
+    return _cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (_result << 16);
+}
+
+int main(int argc, char **argv) {
+    int type = argc > 1 ? std::atoi(argv[1]) : 2;
+    int threads = argc > 2 ? std::atoi(argv[2]) : 4;
+    int dim = argc > 3 ? std::atoi(argv[3]) : 100;
+    const std::size_t ndoc = 100000, nvocab = 200000;
+
+    // Zipfian tokens numbered by first occurrence
+    std::mt19937_64 gen(1234);
+    std::vector<double> weight(nvocab);
+    for (std::size_t i = 0; i < nvocab; ++i)
+        weight[i] = 1.0 / (i + 1);
+    std::discrete_distribution<unsigned int> zipf(weight.begin(), weight.end());
+    std::vector<unsigned int> id(nvocab, 0);
+    types_t types;
+    texts_t texts(ndoc);
+    for (auto &text : texts) {
+        text.resize(20 + gen() % 60);
+        for (auto &token : text) {
+            unsigned int w = zipf(gen);
+            if (id[w] == 0) {
+                types.push_back("w" + std::to_string(w));
+                id[w] = types.size();
+            }
+            token = id[w];
+        }
+    }
+
+    std::printf("%-8s %8s %12s %12s %12s %12s\n", "vocab", "sec", "L1D miss", "LLC miss", 
+                "dTLB miss", "cycles");
+    for (bool sort : {false, true}) {
+        w2v::corpus_t corpus(texts, types);
+        corpus.setWordFreq();
+        if (sort)
+            corpus.sort();
+        w2v::settings_t settings;
+        settings.size = dim;
+        settings.type = type;
+        settings.threads = threads;
+        settings.iterations = 3;
+        w2v::word2vec_t model;
+        w2v::pretrained_t pretrained;
+
+        counter_t l1(PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS));
+        counter_t llc(PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_MISS));
+        counter_t tlb(PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_MISS));
+        counter_t cycles(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        for (auto *c : {&l1, &llc, &tlb, &cycles})
+            c->start();
+        auto start = std::chrono::steady_clock::now();
+        if (!model.train(settings, corpus, pretrained)) {
+            std::printf("%s\n", model.errMsg().c_str());
+            return 1;
+        }
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (auto *c : {&l1, &llc, &tlb, &cycles})
+            c->stop();
+        std::printf("%-8s %8.2f %12.3g %12.3g %12.3g %12.3g\n", sort ? "sorted" : "original", sec,
+                    l1.value(), llc.value(), tlb.value(), cycles.value());
+    }
+    return 0;
+}